@@ -1,51 +1,354 @@
 /**
  * @file CycleCounter.cpp
  * @brief CycleCounter class implementation
- * 
+ *
  * This file holds the CycleCounter class implementation.
- * 
+ *
  */
 
 #include "CycleCounter.hpp"
 
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <sys/mman.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// @brief perf_event type and config of each CounterEvent
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} COUNTER_CONFIGS[COUNTER_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,          "cycles"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,        "instructions"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES,    "cache references"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,        "cache misses"},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,       "branch misses"},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK,          "task clock (ns)"},
+};
+
+/// @brief Layout of a PERF_FORMAT_GROUP read with the enabled and running times
+struct GroupRead {
+    uint64_t nr;
+    uint64_t timeEnabled;
+    uint64_t timeRunning;
+    uint64_t values[COUNTER_EVENTS];
+};
+
 /// @brief Constructor
-CycleCounter::CycleCounter() {
-    struct perf_event_attr attr;
-    memset(&attr, 0, sizeof(attr)); // Zero-initialize the structure
+CycleCounter::CycleCounter() : leader_fd(-1), opened(0), origin(), page(nullptr) {
+    bool excludeKernel = false;
+    int firstError = 0;
+
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        fds[e] = -1;
+        slot[e] = -1;
 
-    attr.type = PERF_TYPE_HARDWARE;           // We want to count hardware events
-    attr.config = PERF_COUNT_HW_CPU_CYCLES;   // Specifically, CPU cycles
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr)); // Zero-initialize the structure
+        attr.size = sizeof(attr);
+        attr.type = COUNTER_CONFIGS[e].type;
+        attr.config = COUNTER_CONFIGS[e].config;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = excludeKernel;
 
-    // Open the performance counter using a syscall
-    // Parameters:
-    // - attr: pointer to the event attributes
-    // - pid: 0 = current process
-    // - cpu: -1 = all CPUs
-    // - group_fd: -1 = no group
-    // - flags: 0 = no special flags
-    fddev = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
-    
-    if (fddev == -1) {
-        perror("perf_event_open failed");  // Print error message
-        exit(EXIT_FAILURE);               // Exit program on failure
+        // Open the performance counter using a syscall
+        // Parameters:
+        // - attr: pointer to the event attributes
+        // - pid: 0 = current thread
+        // - cpu: -1 = any CPU the thread runs on
+        // - group_fd: the first event opened leads the group
+        // - flags: 0 = no special flags
+        int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader_fd, 0);
+
+        // A restricted perf_event_paranoid still allows counting user space only
+        if (fd == -1 && (errno == EACCES || errno == EPERM) && !excludeKernel) {
+            excludeKernel = true;
+            attr.exclude_kernel = 1;
+            fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader_fd, 0);
+        }
+        if (fd == -1) {
+            if (firstError == 0) firstError = errno;
+            continue;
+        }
+
+        if (leader_fd == -1) leader_fd = fd;
+        fds[e] = fd;
+        slot[e] = opened++;
     }
+
+    if (opened == 0) {
+        // Said once per process, the counters are created for every measured function
+        static bool warned = false;
+        if (!warned) {
+            warned = true;
+            std::cerr << "perf_event_open failed: " << strerror(firstError)
+                      << ". Counting nanoseconds instead of cycles." << std::endl;
+        }
+    }
+
+    mapCycles();
+    read(origin);
 }
 
 /// @brief Destructor
 CycleCounter::~CycleCounter() {
-    close(fddev);  // Close the file descriptor when the object is destroyed
+    if (page != nullptr) munmap(page, sysconf(_SC_PAGESIZE));
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        if (fds[e] != -1) close(fds[e]);  // Close the file descriptors when the object is destroyed
+    }
 }
 
-/// @brief Read the current CPU cycle count
-/// @return The number of CPU cycles since the counter was opened
-long long CycleCounter::getCycles() {
-    long long cycles = 0;
+/// @brief Time of the monotonic clock, used when no event can be counted
+long long CycleCounter::monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Read every event of the group at once. If the kernel had to share the hardware counters with
+ * other groups, the values are scaled to the whole time the group was enabled.
+ *
+ * @param sample Events that are not counted are set to 0
+ * @return false if no event is counted
+ */
+bool CycleCounter::read(CounterSample &sample) {
+    memset(&sample, 0, sizeof(sample));
+    if (leader_fd == -1) {
+        return false;
+    }
+
+    GroupRead group;
+    ssize_t expected = static_cast<ssize_t>(sizeof(uint64_t) * (3 + opened));
+    if (::read(leader_fd, &group, sizeof(group)) < expected) {
+        perror("Failed to read the counters");  // Error if read fails
+        return false;
+    }
 
-    // Read the current value from the performance counter
-    if (read(fddev, &cycles, sizeof(cycles)) < (ssize_t)sizeof(cycles)) {
-        perror("Failed to read CPU cycles");  // Error if read fails
+    double scale = 1.0;
+    if (group.timeRunning > 0 && group.timeRunning < group.timeEnabled) {
+        scale = static_cast<double>(group.timeEnabled) / group.timeRunning;
+    }
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        if (slot[e] >= 0) {
+            sample.value[e] = static_cast<long long>(group.values[slot[e]] * scale);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Map the page the kernel keeps for the cycles event, to read the counter with rdpmc. The mapping is kept
+ * only if the kernel allows rdpmc and a user space read falls between two reads through the syscall.
+ */
+void CycleCounter::mapCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (fds[COUNTER_CYCLES] == -1) {
+        return;
+    }
+    void *addr = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, fds[COUNTER_CYCLES], 0);
+    if (addr == MAP_FAILED) {
+        return;
+    }
+    page = static_cast<struct perf_event_mmap_page*>(addr);
+
+    long long before = readCycles();
+    long long user = 0;
+    bool ok = readUserCycles(user);
+    long long after = readCycles();
+    if (!ok || user < before || user > after) {
+        munmap(page, sysconf(_SC_PAGESIZE));
+        page = nullptr;
+    }
+#endif
+}
+
+/**
+ * @brief Read the cycles event from user space, following the protocol of the perf mmap page : the kernel
+ * bumps lock whenever it moves the event, so the read is retried until lock did not change.
+ * When the group is multiplexed, the value is scaled to the whole time the event was enabled, like read() does,
+ * so that a phase may start on one path and end on the other.
+ *
+ * @param cycles
+ * @return false if the event is not on a hardware counter right now, the kernel forbids rdpmc, or the group
+ * is multiplexed and the kernel does not give the time needed to scale
+ */
+bool CycleCounter::readUserCycles(long long &cycles) const {
+#if defined(__x86_64__) || defined(__i386__)
+    const volatile struct perf_event_mmap_page *pc = page;
+    uint32_t seq;
+    long long count;
+    uint64_t enabled;
+    uint64_t running;
+    do {
+        seq = pc->lock;
+        __asm__ __volatile__("" ::: "memory");
+
+        uint32_t index = pc->index;
+        if (!pc->cap_user_rdpmc || index == 0) {
+            return false;
+        }
+        count = pc->offset;
+        int shift = 64 - pc->pmc_width;
+        uint64_t pmc = __rdpmc(index - 1);
+        count += static_cast<long long>(static_cast<int64_t>(pmc << shift) >> shift);
+
+        // The times in the page stop at the last schedule of the event : add the time spent on the counter since
+        enabled = pc->time_enabled;
+        running = pc->time_running;
+        if (enabled != running) {
+            if (!pc->cap_user_time) {
+                return false;
+            }
+            uint16_t timeShift = pc->time_shift;
+            uint64_t tsc = __rdtsc();
+            uint64_t quot = tsc >> timeShift;
+            uint64_t rem = tsc & ((static_cast<uint64_t>(1) << timeShift) - 1);
+            uint64_t delta = pc->time_offset + quot * pc->time_mult + ((rem * pc->time_mult) >> timeShift);
+            enabled += delta;
+            running += delta;
+        }
+
+        __asm__ __volatile__("" ::: "memory");
+    } while (pc->lock != seq);
+
+    if (running > 0 && running < enabled) {
+        count = static_cast<long long>(count * (static_cast<double>(enabled) / running));
+    }
+    cycles = count;
+    return true;
+#else
+    (void)cycles;
+    return false;
+#endif
+}
+
+/// @brief Read the cycles through the syscall. Without a cycles event, the task clock or the monotonic clock
+/// in nanoseconds.
+long long CycleCounter::readCycles() {
+    if (slot[COUNTER_CYCLES] < 0 && slot[COUNTER_TASK_CLOCK] < 0) {
+        return monotonicNs();
+    }
+
+    CounterSample sample;
+    if (!read(sample)) {
         return 0;  // Return 0 if unable to read
     }
+    return slot[COUNTER_CYCLES] >= 0 ? sample.value[COUNTER_CYCLES] : sample.value[COUNTER_TASK_CLOCK];
+}
+
+/// @brief Read the current CPU cycle count, with rdpmc when it is allowed and through the syscall otherwise
+/// @return The number of CPU cycles since the counter was opened. Without a cycles event, the task clock
+/// or the monotonic clock in nanoseconds.
+long long CycleCounter::getCycles() {
+    long long cycles;
+    if (page != nullptr && readUserCycles(cycles)) {
+        return cycles;
+    }
+    return readCycles();
+}
+
+/// @brief Check whether an event is counted on this machine
+bool CycleCounter::isAvailable(CounterEvent event) const {
+    return event >= 0 && event < COUNTER_EVENTS && slot[event] >= 0;
+}
+
+/// @brief Check whether getCycles() reads the counter without a syscall
+bool CycleCounter::isUserSpace() const {
+    return page != nullptr;
+}
+
+/// @brief Name of what getCycles() counts and how it reads it
+const char *CycleCounter::getSource() const {
+    if (page != nullptr) return "cycles (rdpmc)";
+    if (slot[COUNTER_CYCLES] >= 0) return "cycles (read)";
+    if (slot[COUNTER_TASK_CLOCK] >= 0) return "task clock";
+    return "monotonic clock";
+}
+
+/**
+ * @brief Read the timestamp counter of the CPU : rdtsc on x86, cntvct_el0 on ARM, the monotonic clock elsewhere.
+ * It never needs a syscall or a perf event, but it counts wall time at a fixed rate, including the time the
+ * thread is not running ; use getCyclesPerTick() to compare it with getCycles().
+ *
+ * @return The number of ticks since an arbitrary point
+ */
+long long CycleCounter::getTimestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+    return static_cast<long long>(__rdtsc());
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks) :: "memory");
+    return static_cast<long long>(ticks);
+#else
+    return monotonicNs();
+#endif
+}
 
-    return cycles;  // Return the number of cycles read
+/**
+ * @brief Calibrate the timestamp counter against the syscall path of getCycles(), on a busy loop of one
+ * millisecond. The calibration runs once per process.
+ *
+ * @return The number of getCycles() units per timestamp tick
+ */
+double CycleCounter::getCyclesPerTick() {
+    static const double ratio = [this]() {
+        long long cycles = readCycles();
+        long long ticks = getTimestamp();
+        long long startNs = monotonicNs();
+        while (monotonicNs() - startNs < 1000000) {}
+        long long elapsedTicks = getTimestamp() - ticks;
+        long long elapsedCycles = readCycles() - cycles;
+        return elapsedTicks > 0 ? static_cast<double>(elapsedCycles) / elapsedTicks : 0.0;
+    }();
+    return ratio;
+}
+
+/**
+ * @brief Print what every counted event did since a sample, with the instructions per cycle and the cache miss rate.
+ *
+ * @param start
+ * @param label Name of the measured phase
+ */
+void CycleCounter::printSince(const CounterSample &start, const char *label) {
+    CounterSample now;
+    if (!read(now)) {
+        return;
+    }
+
+    long long delta[COUNTER_EVENTS];
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        delta[e] = now.value[e] - start.value[e];
+    }
+
+    std::cout << "Counters " << label << ":";
+    const char *separator = " ";
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        if (slot[e] < 0) continue;
+        std::cout << separator << COUNTER_CONFIGS[e].name << " " << delta[e];
+        separator = ", ";
+    }
+    std::cout << std::endl;
+
+    if (isAvailable(COUNTER_CYCLES) && isAvailable(COUNTER_INSTRUCTIONS) && delta[COUNTER_CYCLES] > 0) {
+        std::cout << "  IPC: " << static_cast<double>(delta[COUNTER_INSTRUCTIONS]) / delta[COUNTER_CYCLES] << std::endl;
+    }
+    if (isAvailable(COUNTER_CACHE_REFERENCES) && isAvailable(COUNTER_CACHE_MISSES) && delta[COUNTER_CACHE_REFERENCES] > 0) {
+        std::cout << "  cache miss rate: " << 100.0 * delta[COUNTER_CACHE_MISSES] / delta[COUNTER_CACHE_REFERENCES] << " %" << std::endl;
+    }
+}
+
+/**
+ * @brief Print what every counted event did since the counter was created.
+ *
+ * @param label Name of the measured phase
+ */
+void CycleCounter::printTotals(const char *label) {
+    printSince(origin, label);
 }
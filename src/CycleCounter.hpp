@@ -1,9 +1,9 @@
 /**
  * @file CycleCounter.hpp
  * @brief CycleCounter class header
- * 
+ *
  * This file holds the CycleCounter class header.
- * 
+ *
  */
 
 #ifndef CYCLECOUNTER_HPP
@@ -16,17 +16,61 @@
 #include <fcntl.h>
 #include <cstring>
 
-/// @brief This class implements the cycles counter
+/// @brief Events of the counter group, in the order they are opened
+enum CounterEvent {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_REFERENCES,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_TASK_CLOCK,     // Nanoseconds on the CPU
+    COUNTER_EVENTS
+};
+
+/// @brief Values of all the events at one point in time. Events the counter could not open stay at 0.
+struct CounterSample {
+    long long value[COUNTER_EVENTS];
+};
+
+/// @brief This class implements the cycles counter. The events are opened as one perf_event group and read
+/// together with a single read(). Events the kernel refuses, e.g. in a container, are left out ; without
+/// any event the counter falls back to the monotonic clock and counts nanoseconds instead of cycles.
+/// When the kernel lets user space read the cycles counter (x86 rdpmc), getCycles() reads it through the
+/// perf mmap page without a syscall.
 class CycleCounter {
     private:
-        int fddev;
-    
+        int leader_fd;
+        int fds[COUNTER_EVENTS];
+        int slot[COUNTER_EVENTS];      // Position of the event in a group read, -1 if the event is not counted
+        int opened;
+        CounterSample origin;          // Values when the counter was created
+        struct perf_event_mmap_page *page;  // Mapped page of the cycles event, nullptr if it is not mapped
+
+        static long long monotonicNs();
+        void mapCycles();
+        bool readUserCycles(long long &cycles) const;
+        long long readCycles();
+
     public:
         CycleCounter();
-    
+
         ~CycleCounter();
 
+        // Delete copy constructor and copy assignment operator
+        CycleCounter(const CycleCounter&) = delete;
+        CycleCounter& operator=(const CycleCounter&) = delete;
+
         long long getCycles();
+        bool read(CounterSample &sample);
+        bool isAvailable(CounterEvent event) const;
+        bool isUserSpace() const;
+        const char *getSource() const;
+
+        static long long getTimestamp();
+        double getCyclesPerTick();
+
+        void printSince(const CounterSample &start, const char *label);
+        void printTotals(const char *label);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,700 @@
+/**
+ * @file EpollServer.cpp
+ * @brief EpollServer implementation
+ *
+ * This file holds the EpollServer class implementation.
+ *
+ */
+
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "EpollServer.hpp"
+#include "drbg.hpp"
+#include "Tracer.hpp"
+
+// Operation of an io_uring completion, in the low byte of its user data ; the file descriptor is above
+#define URING_OP_BUFFERS 0      // Posted by IoUring only when giving a buffer back failed
+#define URING_OP_ACCEPT 1
+#define URING_OP_RECV 2
+#define URING_OP_SEND 3
+
+/// @brief Connection constructor
+EpollServer::Connection::Connection(int fd)
+    : fd(fd), outOffset(0), lastActivity(time(nullptr)), closing(false), binaryWire(false),
+      sendOffset(0), sendInFlight(false), recvArmed(false), shutdownDone(false) {}
+
+/// @brief Constructor
+EpollServer::EpollServer() : listen_fd(-1), epoll_fd(-1), running(false), idleTimeout(TIMEOUT_VALUE), uring(false) {}
+
+/// @brief Destructor closes every peer, the listening socket and the epoll instance
+EpollServer::~EpollServer() {
+#ifdef USE_IO_URING
+    // Closing the ring first cancels the operations still using the connection buffers
+    ring.reset();
+#endif
+    for (auto &it : connections) {
+        close(it.first);
+    }
+    connections.clear();
+    if (listen_fd != -1) close(listen_fd);
+    if (epoll_fd != -1) close(epoll_fd);
+}
+
+/// @brief Serve the peers with io_uring instead of epoll. Must be called before listenOn().
+/// @return false if the server was built without USE_IO_URING or the kernel is older than 6.0 : it keeps epoll then
+bool EpollServer::useIoUring() {
+#ifdef USE_IO_URING
+    if (!IoUring::isSupported()) {
+        std::cerr << "io_uring needs Linux 6.0 or later, keeping epoll." << std::endl;
+        return false;
+    }
+    uring = true;
+    return true;
+#else
+    std::cerr << "Built without USE_IO_URING, keeping epoll." << std::endl;
+    return false;
+#endif
+}
+
+/// @brief Get the name of the backend in use, "epoll" or "io_uring"
+const char *EpollServer::getBackend() const {
+    return uring ? "io_uring" : "epoll";
+}
+
+/// @brief Open a listening socket on the given port and register it in epoll, or arm a multishot accept on it
+/// with the io_uring backend. If the ring cannot be created the server falls back to epoll.
+/// @param port
+/// @param backlog
+/// @return true if the server is ready to accept peers
+bool EpollServer::listenOn(int port, int backlog) {
+#ifdef USE_IO_URING
+    if (uring && !listenUring()) {
+        std::cerr << "io_uring unavailable, falling back to epoll." << std::endl;
+        ring.reset();
+        uring = false;
+    }
+#endif
+    if (!uring) {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd == -1) {
+            perror("epoll_create1 failed");
+            return false;
+        }
+    }
+
+    // io_uring waits for the peers itself, its sockets stay blocking
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | (uring ? 0 : SOCK_NONBLOCK), 0);
+    if (listen_fd == -1) {
+        perror("Socket creation failed");
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        perror("Bind failed");
+        return false;
+    }
+
+    // A swarm reconnecting after a link drop arrives all at once, so keep a deep backlog
+    if (listen(listen_fd, backlog) < 0) {
+        perror("Listen failed");
+        return false;
+    }
+
+#ifdef USE_IO_URING
+    if (uring) {
+        return armAccept();
+    }
+#endif
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = listen_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) < 0) {
+        perror("epoll_ctl failed");
+        return false;
+    }
+
+    return true;
+}
+
+/// @brief Setters for the event handlers
+void EpollServer::onConnect(ConnectHandler handler) { connectHandler = handler; }
+void EpollServer::onMessage(MessageHandler handler) { messageHandler = handler; }
+void EpollServer::onClose(CloseHandler handler) { closeHandler = handler; }
+
+/// @brief Set how long a peer may stay silent before being dropped. 0 disables the check.
+/// @param seconds
+void EpollServer::setIdleTimeout(int seconds) { idleTimeout = seconds; }
+
+/// @brief Accept every pending peer. With edge-triggered epoll the queue must be drained until EAGAIN.
+void EpollServer::acceptAll() {
+    while (true) {
+        struct sockaddr_in peer;
+        socklen_t addr_len = sizeof(peer);
+        int fd = accept4(listen_fd, (struct sockaddr*)&peer, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Accept failed");
+            }
+            return;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl failed");
+            close(fd);
+            continue;
+        }
+
+        connections[fd] = std::unique_ptr<Connection>(new Connection(fd));
+        PROD_ONLY({std::cout << "Peer connected on fd " << fd << ".\n";});
+
+        if (connectHandler) connectHandler(fd);
+    }
+}
+
+/// @brief Read everything available on a peer straight into its unpacker and dispatch each complete message.
+/// @param conn
+void EpollServer::readAll(Connection &conn) {
+    while (!conn.closing) {
+        conn.pac.reserve_buffer(4096);
+        ssize_t bytesReceived = read(conn.fd, conn.pac.buffer(), conn.pac.buffer_capacity());
+
+        if (bytesReceived > 0) {
+            conn.pac.buffer_consumed(bytesReceived);
+            conn.lastActivity = time(nullptr);
+            dispatch(conn);
+        }
+        else if (bytesReceived == 0) {
+            PROD_ONLY({std::cout << "Connection closed by peer on fd " << conn.fd << ".\n";});
+            closeConnection(conn.fd);
+            return;
+        }
+        else {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("Receive failed");
+                closeConnection(conn.fd);
+            }
+            return;
+        }
+    }
+}
+
+/// @brief Hand every complete message of a peer unpacker, msgPack map or binary frame, to the message handler.
+/// @param conn
+void EpollServer::dispatch(Connection &conn) {
+    msgpack::object_handle msgpack_obj;
+    WireFrame frame;
+
+    while (!conn.closing) {
+        WireParse parsed = wireParseNext(conn.pac, msgpack_obj, frame);
+        if (parsed == WIRE_PARSE_NEED_MORE) break;
+        if (parsed == WIRE_PARSE_INVALID) {
+            std::cerr << "Error: expected a map from fd " << conn.fd << std::endl;
+            closeConnection(conn.fd);
+            return;
+        }
+
+        std::unordered_map<std::string, std::string> msg;
+        if (parsed == WIRE_PARSE_FRAME) {
+            conn.binaryWire = true;
+            wireToMap(frame, msg);
+        }
+        else {
+            msgpack::object obj = msgpack_obj.get();
+            msg.reserve(obj.via.map.size);
+            for (uint32_t i = 0; i < obj.via.map.size; ++i) {
+                const msgpack::object_kv& kv = obj.via.map.ptr[i];
+
+                std::string key;
+                std::string value;
+
+                kv.key.convert(key);
+                kv.val.convert(value);
+
+                msg.emplace(std::move(key), std::move(value));
+            }
+        }
+
+        if (messageHandler) messageHandler(conn.fd, msg);
+    }
+}
+
+/// @brief Push the pending output of a peer to the kernel.
+/// @param conn
+/// @return false if the connection is broken, true otherwise (including when the kernel buffer is full)
+bool EpollServer::flush(Connection &conn) {
+    size_t start = conn.outOffset;
+    while (conn.outOffset < conn.out.size()) {
+        ssize_t sent = send(conn.fd, conn.out.data() + conn.outOffset, conn.out.size() - conn.outOffset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.outOffset += sent;
+        }
+        else if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (conn.outOffset != start) conn.lastActivity = time(nullptr);
+            return true;    // EPOLLOUT will tell us when to resume
+        }
+        else {
+            perror("Send failed");
+            return false;
+        }
+    }
+    conn.out.clear();
+    conn.outOffset = 0;
+    return true;
+}
+
+/// @brief Send a message to a peer, as a binary frame if the peer uses them. The message is queued and every
+/// reply of a poll iteration to the same peer leaves in one send, when the iteration ends or, for a message
+/// queued outside of pollOnce(), before the next wait.
+/// @param fd
+/// @param msg
+/// @return false if the peer is unknown or closing
+bool EpollServer::sendMsg(int fd, const std::unordered_map<std::string, std::string> &msg) {
+    auto it = connections.find(fd);
+    if (it == connections.end() || it->second->closing) {
+        std::cerr << "Error: Connection is not open!" << std::endl;
+        return false;
+    }
+
+    Connection &conn = *it->second;
+    bool queued = !conn.out.empty();    // Already waiting for a flush, or for EPOLLOUT
+    wireAppend(conn.out, msg, conn.binaryWire);
+    if (!queued && !conn.sendInFlight) pendingSend.push_back(fd);
+    return true;
+}
+
+/// @brief Flush the peers that got messages since the last flush.
+void EpollServer::flushPending() {
+    std::vector<int> queued;
+    queued.swap(pendingSend);
+    for (int fd : queued) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) continue;
+        Connection &conn = *it->second;
+        if (!flush(conn)) {
+            conn.out.clear();
+            conn.outOffset = 0;
+            closeConnection(fd);
+        }
+    }
+}
+
+/// @brief Ask for a peer to be closed. It is removed once its pending output is flushed, or once it read
+/// nothing for the idle timeout.
+/// @param fd
+void EpollServer::closeConnection(int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end() || it->second->closing) return;
+    it->second->closing = true;
+    it->second->lastActivity = time(nullptr);
+    pendingClose.push_back(fd);
+}
+
+/// @brief Remove a peer for good.
+/// @param fd
+void EpollServer::drop(int fd) {
+    auto it = connections.find(fd);
+    if (it == connections.end()) return;
+
+    if (epoll_fd != -1) epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(it);
+
+    if (closeHandler) closeHandler(fd);
+}
+
+/// @brief Close the peers that stayed silent for longer than the idle timeout.
+void EpollServer::sweepIdle() {
+    if (idleTimeout <= 0) return;
+
+    time_t now = time(nullptr);
+    for (auto &it : connections) {
+        if (!it.second->closing && now - it.second->lastActivity > idleTimeout) {
+            PROD_ONLY({std::cout << "Receive timeout on fd " << it.first << ".\n";});
+            closeConnection(it.first);
+        }
+    }
+}
+
+/// @brief Wait for events and handle all of them.
+/// @param timeoutMs Maximum time to wait, -1 to block
+/// @return The number of events handled, -1 on failure
+int EpollServer::pollOnce(int timeoutMs) {
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+
+    // The next nonces are generated before sleeping rather than during a handshake
+    if (timeoutMs != 0) {
+        drbg_fill(DRBG_PREFILL_SIZE);
+    }
+
+#ifdef USE_IO_URING
+    if (uring) {
+        return pollUring(timeoutMs);
+    }
+#endif
+
+    flushPending();
+
+    int n;
+    {
+        TRACE_PHASE(span, "epoll.wait");
+        n = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, timeoutMs);
+    }
+    if (n < 0) {
+        if (errno == EINTR) return 0;
+        perror("epoll_wait failed");
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int fd = events[i].data.fd;
+
+        if (fd == listen_fd) {
+            acceptAll();
+            continue;
+        }
+
+        auto it = connections.find(fd);
+        if (it == connections.end()) continue;
+        Connection &conn = *it->second;
+
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+            readAll(conn);
+        }
+        if (events[i].events & EPOLLOUT) {
+            if (!flush(conn)) {
+                conn.out.clear();
+                conn.outOffset = 0;
+                closeConnection(fd);
+            }
+        }
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+            closeConnection(fd);
+        }
+    }
+
+    // The replies of this iteration, one send per peer
+    flushPending();
+
+    sweepIdle();
+
+    // Closing peers linger until their last message left, unless the link is broken or the peer stopped reading
+    std::vector<int> lingering;
+    std::vector<int> closing;
+    closing.swap(pendingClose);
+    time_t now = time(nullptr);
+    for (int fd : closing) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) continue;
+        Connection &conn = *it->second;
+        if (conn.outOffset >= conn.out.size() || !flush(conn) || conn.outOffset >= conn.out.size()) {
+            drop(fd);
+        } else if (idleTimeout > 0 && now - conn.lastActivity > idleTimeout) {
+            PROD_ONLY({std::cout << "Send timeout on fd " << fd << ".\n";});
+            drop(fd);
+        } else {
+            lingering.push_back(fd);
+        }
+    }
+    pendingClose.insert(pendingClose.end(), lingering.begin(), lingering.end());
+
+    return n;
+}
+
+#ifdef USE_IO_URING
+
+/// @brief Create the ring and its provided receive buffers
+bool EpollServer::listenUring() {
+    ring.reset(new IoUring());
+    return ring->setup(URING_ENTRIES) && ring->setupBuffers(URING_BUFFERS, URING_BUFFER_SIZE, 0);
+}
+
+/// @brief Next free submission entry, handing the prepared ones to the kernel first if the queue is full
+struct io_uring_sqe *EpollServer::nextSqe() {
+    struct io_uring_sqe *sqe = ring->getSqe();
+    if (sqe == nullptr && ring->submit(0, 0) >= 0) {
+        sqe = ring->getSqe();
+    }
+    if (sqe == nullptr) {
+        std::cerr << "Error: io_uring submission queue full" << std::endl;
+    }
+    return sqe;
+}
+
+/// @brief Give a receive buffer back to the kernel, with the next submission
+/// @param id
+void EpollServer::recycle(unsigned id) {
+    if (!ring->recycleBuffer(id)) {
+        std::cerr << "Error: io_uring submission queue full, receive buffer " << id << " lost" << std::endl;
+    }
+}
+
+/// @brief Accept every future peer with one request, it completes once per peer
+bool EpollServer::armAccept() {
+    struct io_uring_sqe *sqe = nextSqe();
+    if (sqe == nullptr) return false;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = (static_cast<uint64_t>(listen_fd) << 8) | URING_OP_ACCEPT;
+    return true;
+}
+
+/// @brief Receive everything a peer sends with one request. The kernel picks a provided buffer for each chunk.
+/// @param conn
+bool EpollServer::armRecv(Connection &conn) {
+    struct io_uring_sqe *sqe = nextSqe();
+    if (sqe == nullptr) return false;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = ring->getBufferGroup();
+    sqe->user_data = (static_cast<uint64_t>(conn.fd) << 8) | URING_OP_RECV;
+    conn.recvArmed = true;
+    return true;
+}
+
+/// @brief Send everything queued for a peer in one request, or the rest of a partial send. The bytes move to
+/// conn.sending so that new replies can be queued while the kernel reads them.
+/// @param conn
+bool EpollServer::submitSend(Connection &conn) {
+    struct io_uring_sqe *sqe = nextSqe();
+    if (sqe == nullptr) return false;
+    if (conn.sending.empty()) {
+        conn.sending.swap(conn.out);
+        conn.sendOffset = 0;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(conn.sending.data() + conn.sendOffset);
+    sqe->len = static_cast<uint32_t>(conn.sending.size() - conn.sendOffset);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (static_cast<uint64_t>(conn.fd) << 8) | URING_OP_SEND;
+    conn.sendInFlight = true;
+    return true;
+}
+
+/// @brief Prepare a send for every peer with queued replies and none in flight
+void EpollServer::submitSends() {
+    std::vector<int> queued;
+    queued.swap(pendingSend);
+    for (size_t i = 0; i < queued.size(); i++) {
+        auto it = connections.find(queued[i]);
+        if (it == connections.end()) continue;
+        Connection &conn = *it->second;
+        if (conn.sendInFlight || conn.out.empty()) continue;
+        if (!submitSend(conn)) {
+            pendingSend.insert(pendingSend.end(), queued.begin() + i, queued.end());
+            return;
+        }
+    }
+}
+
+/// @brief Handle one completion.
+/// @param data User data of the request : file descriptor and operation
+/// @param res Result, a byte count, a new file descriptor or a negative errno
+/// @param flags Completion flags
+void EpollServer::complete(uint64_t data, int res, unsigned flags) {
+    int fd = static_cast<int>(data >> 8);
+    int op = static_cast<int>(data & 0xff);
+
+    if (op == URING_OP_BUFFERS) {
+        std::cerr << "Error: a receive buffer was not given back: " << strerror(-res) << std::endl;
+        return;
+    }
+
+    if (op == URING_OP_ACCEPT) {
+        if (res >= 0) {
+            connections[res] = std::unique_ptr<Connection>(new Connection(res));
+            PROD_ONLY({std::cout << "Peer connected on fd " << res << ".\n";});
+            if (!armRecv(*connections[res])) {
+                closeConnection(res);
+            }
+            else if (connectHandler) {
+                connectHandler(res);
+            }
+        }
+        else {
+            std::cerr << "Accept failed: " << strerror(-res) << std::endl;
+        }
+        if (!(flags & IORING_CQE_F_MORE)) armAccept();
+        return;
+    }
+
+    auto it = connections.find(fd);
+    if (it == connections.end()) {
+        if (flags & IORING_CQE_F_BUFFER) recycle(flags >> IORING_CQE_BUFFER_SHIFT);
+        return;
+    }
+    Connection &conn = *it->second;
+
+    if (op == URING_OP_RECV) {
+        if (!(flags & IORING_CQE_F_MORE)) conn.recvArmed = false;
+        if (flags & IORING_CQE_F_BUFFER) {
+            unsigned id = flags >> IORING_CQE_BUFFER_SHIFT;
+            if (res > 0) {
+                conn.pac.reserve_buffer(res);
+                memcpy(conn.pac.buffer(), ring->getBuffer(id), res);
+                conn.pac.buffer_consumed(res);
+            }
+            recycle(id);
+        }
+
+        if (res > 0) {
+            conn.lastActivity = time(nullptr);
+            dispatch(conn);
+        }
+        else if (res == 0) {
+            if (!conn.closing) {
+                PROD_ONLY({std::cout << "Connection closed by peer on fd " << fd << ".\n";});
+                closeConnection(fd);
+            }
+            return;
+        }
+        else if (res != -ENOBUFS) {     // Out of provided buffers is transient, they were recycled since
+            if (!conn.closing) {
+                std::cerr << "Receive failed: " << strerror(-res) << std::endl;
+                closeConnection(fd);
+            }
+            return;
+        }
+        if (!conn.recvArmed && !conn.closing && !armRecv(conn)) {
+            closeConnection(fd);
+        }
+        return;
+    }
+
+    conn.sendInFlight = false;
+    if (res < 0) {
+        std::cerr << "Send failed: " << strerror(-res) << std::endl;
+        conn.sending.clear();
+        conn.out.clear();
+        closeConnection(fd);
+        return;
+    }
+    conn.sendOffset += res;
+    if (res > 0) conn.lastActivity = time(nullptr);
+    if (conn.sendOffset < conn.sending.size()) {
+        if (!submitSend(conn)) pendingSend.push_back(fd);
+        return;
+    }
+    conn.sending.clear();
+    conn.sendOffset = 0;
+    if (!conn.out.empty()) pendingSend.push_back(fd);
+}
+
+/// @brief io_uring version of pollOnce() : submit the queued sends and wait for completions in one syscall,
+/// then handle all of them.
+/// @param timeoutMs Maximum time to wait, -1 to block
+/// @return The number of completions handled, -1 on failure
+int EpollServer::pollUring(int timeoutMs) {
+    submitSends();
+
+    int ret;
+    {
+        TRACE_PHASE(span, "uring.wait");
+        ret = ring->submit(timeoutMs == 0 ? 0 : 1, timeoutMs);
+    }
+    if (ret < 0) {
+        return -1;
+    }
+
+    int n = 0;
+    struct io_uring_cqe *cqe;
+    while ((cqe = ring->peekCqe()) != nullptr) {
+        uint64_t data = cqe->user_data;
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+        ring->seenCqe();
+        complete(data, res, flags);
+        n++;
+    }
+
+    sweepIdle();
+
+    // Closing peers linger until their last message left, then until the shutdown ended their receive. The kernel
+    // owns the buffer of a send in flight : a peer that stopped reading is shut down, which fails the send, and
+    // dropped once the send completed.
+    std::vector<int> lingering;
+    std::vector<int> closing;
+    closing.swap(pendingClose);
+    time_t now = time(nullptr);
+    for (int fd : closing) {
+        auto it = connections.find(fd);
+        if (it == connections.end()) continue;
+        Connection &conn = *it->second;
+        if (idleTimeout > 0 && now - conn.lastActivity > idleTimeout && (conn.sendInFlight || !conn.out.empty())) {
+            PROD_ONLY({std::cout << "Send timeout on fd " << fd << ".\n";});
+            conn.out.clear();
+            if (!conn.shutdownDone) {
+                shutdown(fd, SHUT_RDWR);
+                conn.shutdownDone = true;
+            }
+        }
+        if (conn.sendInFlight || !conn.out.empty()) {
+            lingering.push_back(fd);
+            continue;
+        }
+        if (!conn.shutdownDone) {
+            shutdown(fd, SHUT_RDWR);
+            conn.shutdownDone = true;
+        }
+        if (conn.recvArmed) {
+            lingering.push_back(fd);
+        } else {
+            drop(fd);
+        }
+    }
+    pendingClose.insert(pendingClose.end(), lingering.begin(), lingering.end());
+
+    return n;
+}
+
+#endif
+
+/// @brief Drive every peer until stop() is called.
+void EpollServer::run() {
+    running = true;
+    while (running) {
+        if (pollOnce(1000) < 0) break;
+    }
+}
+
+/// @brief Make run() return after the current iteration.
+void EpollServer::stop() {
+    running = false;
+}
+
+/// @brief Get the number of peers currently connected
+size_t EpollServer::connectionCount() const {
+    return connections.size();
+}
+
+/// @brief Get the listening socket file descriptor
+int EpollServer::getListenFd() const {
+    return listen_fd;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file EpollServer.hpp
+ * @brief EpollServer class header
+ *
+ * This file holds the EpollServer class header.
+ *
+ */
+
+#ifndef EpollServer_HPP
+#define EpollServer_HPP
+
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <msgpack.hpp>
+
+#include "SocketModule.hpp"
+#include "IoUring.hpp"
+
+#define EPOLL_MAX_EVENTS 256
+#define URING_ENTRIES 256       // Submission queue size of the io_uring backend
+#define URING_BUFFERS 256       // Provided receive buffers
+#define URING_BUFFER_SIZE 4096
+
+/// @brief Event-driven server. It accepts many peers on one listening socket and drives all of them
+/// from a single thread using edge-triggered epoll and non-blocking file descriptors. When built with USE_IO_URING,
+/// useIoUring() switches it to an io_uring backend : one multishot accept, one multishot receive per peer
+/// filling provided buffers, and the replies of a whole iteration submitted with the wait in a single syscall.
+class EpollServer {
+public:
+    typedef std::function<void(int fd)> ConnectHandler;
+    typedef std::function<void(int fd, const std::unordered_map<std::string, std::string> &msg)> MessageHandler;
+    typedef std::function<void(int fd)> CloseHandler;
+
+private:
+    /// @brief Per peer state : its own unpacker and a pending output buffer.
+    struct Connection {
+        int fd;
+        msgpack::unpacker pac;
+        std::string out;        // Bytes not yet accepted by the kernel
+        size_t outOffset;
+        time_t lastActivity;    // Last traffic, or start of the close : a closing peer lingers at most idleTimeout
+        bool closing;
+        bool binaryWire;        // The peer sent binary frames, answer with frames
+        std::string sending;    // io_uring backend : bytes owned by the send in flight
+        size_t sendOffset;
+        bool sendInFlight;
+        bool recvArmed;
+        bool shutdownDone;
+
+        explicit Connection(int fd);
+    };
+
+    int listen_fd;
+    int epoll_fd;
+    bool running;
+    int idleTimeout;    // Seconds without traffic before a peer is dropped, 0 disables it
+
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    std::vector<int> pendingClose;
+
+    ConnectHandler connectHandler;
+    MessageHandler messageHandler;
+    CloseHandler closeHandler;
+
+    std::vector<int> pendingSend;       // Peers with messages queued since the last flush
+
+    bool uring;             // Serve the peers with io_uring instead of epoll
+#ifdef USE_IO_URING
+    std::unique_ptr<IoUring> ring;
+
+    bool listenUring();
+    struct io_uring_sqe *nextSqe();
+    void recycle(unsigned id);
+    bool armAccept();
+    bool armRecv(Connection &conn);
+    bool submitSend(Connection &conn);
+    void submitSends();
+    void complete(uint64_t data, int res, unsigned flags);
+    int pollUring(int timeoutMs);
+#endif
+
+    void acceptAll();
+    void readAll(Connection &conn);
+    void dispatch(Connection &conn);
+    bool flush(Connection &conn);
+    void flushPending();
+    void drop(int fd);
+    void sweepIdle();
+
+public:
+    EpollServer();
+
+    // Delete copy constructor and copy assignment operator
+    EpollServer(const EpollServer&) = delete;
+    EpollServer& operator=(const EpollServer&) = delete;
+
+    ~EpollServer();
+
+    bool useIoUring();
+    const char *getBackend() const;
+    bool listenOn(int port, int backlog = SOMAXCONN);
+
+    void onConnect(ConnectHandler handler);
+    void onMessage(MessageHandler handler);
+    void onClose(CloseHandler handler);
+    void setIdleTimeout(int seconds);
+
+    bool sendMsg(int fd, const std::unordered_map<std::string, std::string> &msg);
+    void closeConnection(int fd);
+
+    int pollOnce(int timeoutMs);
+    void run();
+    void stop();
+
+    size_t connectionCount() const;
+    int getListenFd() const;
+};
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ * @file IoUring.cpp
+ * @brief IoUring class implementation
+ *
+ * This file holds the IoUring class implementation.
+ *
+ */
+
+#include "IoUring.hpp"
+
+#ifdef USE_IO_URING
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+/// @brief Constructor, see setup()
+IoUring::IoUring()
+    : ring_fd(-1), sqRing(MAP_FAILED), sqRingSize(0), sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr),
+      sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED)), sqesSize(0), sqEntries(0), sqLocalTail(0),
+      cqRing(MAP_FAILED), cqRingSize(0), cqHead(nullptr), cqTail(nullptr), cqMask(nullptr), cqes(nullptr),
+      bufData(nullptr), bufCount(0), bufSize(0), bufGroup(0) {}
+
+/// @brief Destructor unmaps the queues and the buffers and closes the ring
+IoUring::~IoUring() {
+    free(bufData);
+    if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+    if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+    if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+    if (ring_fd != -1) close(ring_fd);
+}
+
+/// @brief Check that the kernel has everything the server uses : multishot accept came with Linux 5.19,
+/// multishot receives with 6.0.
+bool IoUring::isSupported() {
+    struct utsname name;
+    if (uname(&name) != 0) {
+        return false;
+    }
+    int major = 0;
+    if (sscanf(name.release, "%d.", &major) != 1) {
+        return false;
+    }
+    return major >= 6;
+}
+
+/**
+ * @brief Create the ring and map its queues.
+ *
+ * @param entries Size of the submission queue, the completion queue is twice as large
+ * @return false if the kernel refuses io_uring, e.g. when it is disabled by a sysctl or a seccomp filter
+ */
+bool IoUring::setup(unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring_fd < 0) {
+        perror("io_uring_setup failed");
+        ring_fd = -1;
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        std::fprintf(stderr, "io_uring: the kernel cannot wait with a timeout.\n");
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cqRingSize > sqRingSize) sqRingSize = cqRingSize;
+        cqRingSize = sqRingSize;
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        perror("io_uring mmap failed");
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            perror("io_uring mmap failed");
+            return false;
+        }
+    }
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqesMap == MAP_FAILED) {
+        perror("io_uring mmap failed");
+        return false;
+    }
+    sqes = static_cast<struct io_uring_sqe*>(sqesMap);
+
+    char *sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqEntries = params.sq_entries;
+    sqLocalTail = *sqTail;
+
+    char *cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+/**
+ * @brief Provide a group of buffers. A receive submitted with IOSQE_BUFFER_SELECT on this group takes one of
+ * them when data arrives, instead of holding a buffer per connection while it waits.
+ *
+ * @param count Number of buffers
+ * @param size Size of each buffer
+ * @param group Buffer group id
+ * @return false if the kernel refuses the buffers
+ */
+bool IoUring::setupBuffers(unsigned count, unsigned size, unsigned short group) {
+    bufData = static_cast<char*>(malloc(static_cast<size_t>(count) * size));
+    if (bufData == nullptr) {
+        return false;
+    }
+    bufCount = count;
+    bufSize = size;
+    bufGroup = group;
+
+    if (!provideBuffers(0, count, false) || submit(1, -1) < 0) {
+        return false;
+    }
+    struct io_uring_cqe *cqe = peekCqe();
+    int res = cqe != nullptr ? cqe->res : -EAGAIN;
+    if (cqe != nullptr) seenCqe();
+    if (res < 0) {
+        std::fprintf(stderr, "io_uring: cannot provide the receive buffers: %s\n", strerror(-res));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Queue the request handing consecutive buffers to the kernel.
+ *
+ * @param first Id of the first buffer
+ * @param count Number of buffers
+ * @param skipSuccess Post a completion only on failure
+ * @return false if the submission queue is full and cannot be flushed
+ */
+bool IoUring::provideBuffers(unsigned first, unsigned count, bool skipSuccess) {
+    struct io_uring_sqe *sqe = getSqe();
+    if (sqe == nullptr && submit(0, 0) >= 0) {
+        sqe = getSqe();
+    }
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(getBuffer(first));
+    sqe->len = bufSize;
+    sqe->off = first;
+    sqe->buf_group = bufGroup;
+    if (skipSuccess) sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = 0;
+    return true;
+}
+
+/// @brief Next free submission entry, zeroed. nullptr if the queue is full : call submit() first.
+struct io_uring_sqe *IoUring::getSqe() {
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (sqLocalTail - head >= sqEntries) {
+        return nullptr;
+    }
+    unsigned index = sqLocalTail & *sqMask;
+    struct io_uring_sqe *sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    sqLocalTail++;
+    return sqe;
+}
+
+/**
+ * @brief Hand the prepared entries to the kernel and wait for completions, in a single syscall.
+ *
+ * @param waitCount Number of completions to wait for, 0 to return at once
+ * @param timeoutMs Maximum time to wait, -1 to block
+ * @return The number of entries submitted, 0 on timeout or signal, -1 on failure
+ */
+int IoUring::submit(unsigned waitCount, int timeoutMs) {
+    unsigned toSubmit = sqLocalTail - *sqTail;
+    __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (waitCount > 0) {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        arg.sigmask_sz = _NSIG / 8;
+        if (timeoutMs >= 0) {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+    }
+    if (toSubmit == 0 && waitCount == 0) {
+        return 0;
+    }
+
+    int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, toSubmit, waitCount, flags,
+                                       waitCount > 0 ? &arg : nullptr, waitCount > 0 ? sizeof(arg) : 0));
+    if (ret < 0) {
+        if (errno == ETIME || errno == EINTR) return 0;
+        perror("io_uring_enter failed");
+        return -1;
+    }
+    return ret;
+}
+
+/// @brief Next completion, nullptr if there is none. Call seenCqe() once it is handled.
+struct io_uring_cqe *IoUring::peekCqe() {
+    unsigned head = *cqHead;
+    if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+        return nullptr;
+    }
+    return &cqes[head & *cqMask];
+}
+
+/// @brief Give the last completion returned by peekCqe() back to the kernel
+void IoUring::seenCqe() {
+    __atomic_store_n(cqHead, *cqHead + 1, __ATOMIC_RELEASE);
+}
+
+/// @brief Address of a provided buffer, from the buffer id of a completion
+char *IoUring::getBuffer(unsigned id) const {
+    return bufData + static_cast<size_t>(id) * bufSize;
+}
+
+/// @brief Give a provided buffer back to the kernel once its data was copied. The request goes with the next
+/// submission and posts a completion, with user data 0, only if it fails.
+bool IoUring::recycleBuffer(unsigned id) {
+    return provideBuffers(id, 1, true);
+}
+
+unsigned short IoUring::getBufferGroup() const {
+    return bufGroup;
+}
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file IoUring.hpp
+ * @brief IoUring class header
+ *
+ * This file holds the IoUring class header.
+ *
+ */
+
+#ifndef IOURING_HPP
+#define IOURING_HPP
+
+// The io_uring backend needs the headers of Linux 6.0 or later, it is only built with USE_IO_URING
+#ifdef USE_IO_URING
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+
+/// @brief Minimal io_uring ring on top of the raw syscalls : a submission and a completion queue, and one
+/// group of provided buffers the kernel picks from for the receives. The ring is used from a single thread.
+class IoUring {
+    private:
+        int ring_fd;
+
+        // Submission queue, shared with the kernel
+        void *sqRing;
+        size_t sqRingSize;
+        unsigned *sqHead;
+        unsigned *sqTail;
+        unsigned *sqMask;
+        unsigned *sqArray;
+        struct io_uring_sqe *sqes;
+        size_t sqesSize;
+        unsigned sqEntries;
+        unsigned sqLocalTail;   // Entries prepared but not yet handed to the kernel
+
+        // Completion queue, shared with the kernel
+        void *cqRing;
+        size_t cqRingSize;
+        unsigned *cqHead;
+        unsigned *cqTail;
+        unsigned *cqMask;
+        struct io_uring_cqe *cqes;
+
+        // Provided buffers
+        char *bufData;
+        unsigned bufCount;
+        unsigned bufSize;
+        unsigned short bufGroup;
+
+        bool provideBuffers(unsigned first, unsigned count, bool skipSuccess);
+
+    public:
+        IoUring();
+        ~IoUring();
+
+        // Delete copy constructor and copy assignment operator
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        static bool isSupported();
+
+        bool setup(unsigned entries);
+        bool setupBuffers(unsigned count, unsigned size, unsigned short group);
+
+        struct io_uring_sqe *getSqe();
+        int submit(unsigned waitCount, int timeoutMs);
+        struct io_uring_cqe *peekCqe();
+        void seenCqe();
+
+        char *getBuffer(unsigned id) const;
+        bool recycleBuffer(unsigned id);
+        unsigned short getBufferGroup() const;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,306 @@
+/**
+ * @file LatencyHistogram.cpp
+ * @brief LatencyHistogram class implementation
+ *
+ * This file holds the LatencyHistogram class implementation.
+ *
+ */
+
+#include "LatencyHistogram.hpp"
+
+#include <climits>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#define HISTOGRAM_LINEAR (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+
+/// @brief Histograms shared by name, e.g. "authentication.op"
+struct HistogramRegistry {
+    std::mutex lock;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+};
+
+static HistogramRegistry &registry() {
+    static HistogramRegistry instance;
+    return instance;
+}
+
+/// @brief Constructor
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+/// @brief Bucket of a value. Negative values count as 0.
+int LatencyHistogram::bucketOf(long long value) {
+    if (value < HISTOGRAM_LINEAR) {
+        return value < 0 ? 0 : static_cast<int>(value);
+    }
+    uint64_t v = static_cast<uint64_t>(value);
+    int msb = 63 - __builtin_clzll(v);
+    int group = msb - HISTOGRAM_SUB_BITS + 1;   // The group covers [2^msb, 2^(msb + 1)) in steps of 2^group
+    int sub = static_cast<int>(v >> group) - HISTOGRAM_HALF;
+    return HISTOGRAM_LINEAR + (group - 1) * HISTOGRAM_HALF + sub;
+}
+
+/// @brief Highest value that falls in a bucket
+long long LatencyHistogram::highestIn(int bucket) {
+    if (bucket < HISTOGRAM_LINEAR) {
+        return bucket;
+    }
+    int group = (bucket - HISTOGRAM_LINEAR) / HISTOGRAM_HALF + 1;
+    uint64_t sub = static_cast<uint64_t>((bucket - HISTOGRAM_LINEAR) % HISTOGRAM_HALF);
+    uint64_t low = (sub + HISTOGRAM_HALF) << group;
+    return static_cast<long long>(low + ((uint64_t(1) << group) - 1));
+}
+
+void LatencyHistogram::add(int bucket, uint64_t count) {
+    counts[bucket].fetch_add(count, std::memory_order_relaxed);
+    total.fetch_add(count, std::memory_order_relaxed);
+}
+
+/// @brief Widen the recorded range to [low, high]
+void LatencyHistogram::updateRange(long long low, long long high) {
+    long long current = minValue.load(std::memory_order_relaxed);
+    while (low < current && !minValue.compare_exchange_weak(current, low, std::memory_order_relaxed)) {}
+    current = maxValue.load(std::memory_order_relaxed);
+    while (high > current && !maxValue.compare_exchange_weak(current, high, std::memory_order_relaxed)) {}
+}
+
+/**
+ * @brief Record one value. Safe to call from several threads at once.
+ *
+ * @param value e.g. a number of cycles
+ */
+void LatencyHistogram::record(long long value) {
+    if (value < 0) value = 0;
+    add(bucketOf(value), 1);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    updateRange(value, value);
+}
+
+/**
+ * @brief Add the values of another histogram, e.g. the one of another thread.
+ *
+ * @param other
+ */
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    uint64_t count = other.getCount();
+    if (count == 0) {
+        return;
+    }
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        uint64_t n = other.counts[b].load(std::memory_order_relaxed);
+        if (n != 0) add(b, n);
+    }
+    sum.fetch_add(other.sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    updateRange(other.getMin(), other.getMax());
+}
+
+/// @brief Forget every value. Not safe while other threads record.
+void LatencyHistogram::reset() {
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        counts[b].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+    minValue.store(LLONG_MAX, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return total.load(std::memory_order_relaxed);
+}
+
+long long LatencyHistogram::getMin() const {
+    return getCount() == 0 ? 0 : minValue.load(std::memory_order_relaxed);
+}
+
+long long LatencyHistogram::getMax() const {
+    return maxValue.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::getMean() const {
+    uint64_t count = getCount();
+    return count == 0 ? 0 : static_cast<double>(sum.load(std::memory_order_relaxed)) / count;
+}
+
+/**
+ * @brief Value below which a share of the recorded values fall, within the precision of the buckets.
+ *
+ * @param p Share between 0 and 1, e.g. 0.999
+ * @return The highest value of the bucket reaching the share, at most the maximum recorded ; 0 if empty
+ */
+long long LatencyHistogram::percentile(double p) const {
+    uint64_t count = getCount();
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(p * count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += counts[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            long long value = highestIn(b);
+            return value < getMax() ? value : getMax();
+        }
+    }
+    return getMax();
+}
+
+/**
+ * @brief Print the number of values and the p50, p90, p99, p99.9 and max on one line.
+ *
+ * @param out
+ * @param name
+ * @param unit e.g. "cycles"
+ */
+void LatencyHistogram::print(std::ostream &out, const std::string &name, const char *unit) const {
+    out << name << " (" << unit << ") : " << getCount() << " samples";
+    if (getCount() > 0) {
+        out << ", p50 " << percentile(0.50) << ", p90 " << percentile(0.90) << ", p99 " << percentile(0.99)
+            << ", p99.9 " << percentile(0.999) << ", max " << getMax() << ", mean " << getMean();
+    }
+    out << std::endl;
+}
+
+/**
+ * @brief Write the histogram on one line : name, bucket precision, count, min, max, sum, then the
+ * non-empty buckets as index:count.
+ *
+ * @param out
+ * @param name Without spaces
+ */
+void LatencyHistogram::save(std::ostream &out, const std::string &name) const {
+    out << name << " " << HISTOGRAM_SUB_BITS << " " << getCount() << " " << getMin() << " " << getMax() << " "
+        << sum.load(std::memory_order_relaxed);
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        uint64_t n = counts[b].load(std::memory_order_relaxed);
+        if (n != 0) out << " " << b << ":" << n;
+    }
+    out << "\n";
+}
+
+/**
+ * @brief Add a histogram written by save(), from after its name.
+ *
+ * @param line
+ * @return false if the line is malformed or has another bucket precision. Nothing is added then.
+ */
+bool LatencyHistogram::load(std::istream &line) {
+    int subBits;
+    uint64_t count;
+    long long low, high, values;
+    if (!(line >> subBits >> count >> low >> high >> values) || subBits != HISTOGRAM_SUB_BITS) {
+        return false;
+    }
+
+    LatencyHistogram loaded;
+    std::string entry;
+    while (line >> entry) {
+        std::istringstream pair(entry);
+        int bucket;
+        char colon;
+        uint64_t n;
+        if (!(pair >> bucket >> colon >> n) || colon != ':' || bucket < 0 || bucket >= HISTOGRAM_BUCKETS) {
+            return false;
+        }
+        loaded.add(bucket, n);
+    }
+    if (loaded.getCount() != count) {
+        return false;
+    }
+    if (count > 0) {
+        loaded.sum.store(values, std::memory_order_relaxed);
+        loaded.updateRange(low, high);
+    }
+    merge(loaded);
+    return true;
+}
+
+/**
+ * @brief Histogram shared under a name, created empty the first time. The reference stays valid until the
+ * process ends.
+ *
+ * @param name e.g. "authentication.op"
+ */
+LatencyHistogram &LatencyHistogram::named(const std::string &name) {
+    HistogramRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    std::unique_ptr<LatencyHistogram> &histogram = reg.histograms[name];
+    if (!histogram) {
+        histogram.reset(new LatencyHistogram());
+    }
+    return *histogram;
+}
+
+/// @brief Print every named histogram that has values, in name order
+void LatencyHistogram::printAll(std::ostream &out, const char *unit) {
+    HistogramRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    for (const auto &entry : reg.histograms) {
+        if (entry.second->getCount() > 0) {
+            entry.second->print(out, entry.first, unit);
+        }
+    }
+}
+
+/**
+ * @brief Append every named histogram that has values to a file, so that the runs of several processes
+ * can be merged with loadAll().
+ *
+ * @param path
+ * @return 0 if success, 1 if the file cannot be written
+ */
+int LatencyHistogram::appendAll(const std::string &path) {
+    std::ofstream file(path.c_str(), std::ios::app);
+    if (!file) {
+        std::cerr << "Error: cannot write the histograms to " << path << std::endl;
+        return 1;
+    }
+    // One write, so processes appending to the same file do not mix their lines
+    std::ostringstream lines;
+    {
+        HistogramRegistry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        for (const auto &entry : reg.histograms) {
+            if (entry.second->getCount() > 0) {
+                entry.second->save(lines, entry.first);
+            }
+        }
+    }
+    file << lines.str() << std::flush;
+    return file ? 0 : 1;
+}
+
+/**
+ * @brief Merge every histogram of a file written by appendAll() into the named histograms.
+ *
+ * @param path
+ * @return 0 if success, 1 if the file cannot be read or a line is malformed
+ */
+int LatencyHistogram::loadAll(const std::string &path) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        std::cerr << "Error: cannot read the histograms from " << path << std::endl;
+        return 1;
+    }
+    int ret = 0;
+    std::string text;
+    while (std::getline(file, text)) {
+        std::istringstream line(text);
+        std::string name;
+        if (!(line >> name)) continue;
+        if (!named(name).load(line)) {
+            std::cerr << "Error: malformed histogram " << name << " in " << path << std::endl;
+            ret = 1;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file LatencyHistogram.hpp
+ * @brief LatencyHistogram class header
+ *
+ * This file holds the LatencyHistogram class header.
+ *
+ */
+
+#ifndef LATENCYHISTOGRAM_HPP
+#define LATENCYHISTOGRAM_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#define HISTOGRAM_SUB_BITS 7    // 2^7 linear steps per power of two : values are kept within 1/64
+#define HISTOGRAM_BUCKETS ((1 << HISTOGRAM_SUB_BITS) + (63 - HISTOGRAM_SUB_BITS) * (1 << (HISTOGRAM_SUB_BITS - 1)))
+
+/// @brief Log-linear histogram of non-negative values, like HdrHistogram : the values below 2^7 have a bucket
+/// each, then every power of two is split into 64 buckets of the same width. Recording is a few instructions
+/// and lock-free, so several threads can share one histogram ; histograms of other threads or processes
+/// are added with merge() or load().
+class LatencyHistogram {
+    private:
+        std::atomic<uint64_t> counts[HISTOGRAM_BUCKETS];
+        std::atomic<uint64_t> total;
+        std::atomic<long long> minValue;
+        std::atomic<long long> maxValue;
+        std::atomic<long long> sum;
+
+        static int bucketOf(long long value);
+        static long long highestIn(int bucket);
+        void add(int bucket, uint64_t count);
+        void updateRange(long long low, long long high);
+
+    public:
+        LatencyHistogram();
+
+        // Delete copy constructor and copy assignment operator
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        void record(long long value);
+        void merge(const LatencyHistogram &other);
+        void reset();
+
+        uint64_t getCount() const;
+        long long getMin() const;
+        long long getMax() const;
+        double getMean() const;
+        long long percentile(double p) const;
+
+        void print(std::ostream &out, const std::string &name, const char *unit) const;
+        void save(std::ostream &out, const std::string &name) const;
+        bool load(std::istream &line);
+
+        static LatencyHistogram &named(const std::string &name);
+        static void printAll(std::ostream &out, const char *unit);
+        static int appendAll(const std::string &path);
+        static int loadAll(const std::string &path);
+};
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file MsgView.cpp
+ * @brief MsgView implementation
+ *
+ * This file holds the MsgView class implementation.
+ *
+ */
+
+#include "MsgView.hpp"
+
+/// @brief Constructor: the view starts empty
+MsgView::MsgView() : kind(EMPTY), frame(nullptr) {}
+
+/// @brief Forget the current message
+void MsgView::clear() {
+    kind = EMPTY;
+    frame = nullptr;
+}
+
+/// @brief Check if a message was received
+bool MsgView::empty() const {
+    return kind == EMPTY;
+}
+
+/**
+ * @brief Find the value of a key without copying it.
+ *
+ * @param key
+ * @param size Set to the size of the value
+ * @return Pointer to the value, nullptr if the key is absent
+ */
+const unsigned char* MsgView::find(const char *key, size_t &size) const {
+    if (kind == FRAME) {
+        return wireFind(*frame, key, size);
+    }
+    if (kind == MSGPACK) {
+        const msgpack::object &obj = handle.get();
+        size_t keyLength = strlen(key);
+
+        for (uint32_t i = 0; i < obj.via.map.size; ++i) {
+            const msgpack::object_kv& kv = obj.via.map.ptr[i];
+            if (kv.key.type != msgpack::type::STR || kv.key.via.str.size != keyLength
+                || memcmp(kv.key.via.str.ptr, key, keyLength) != 0) {
+                continue;
+            }
+            if (kv.val.type == msgpack::type::STR) {
+                size = kv.val.via.str.size;
+                return reinterpret_cast<const unsigned char*>(kv.val.via.str.ptr);
+            }
+            if (kv.val.type == msgpack::type::BIN) {
+                size = kv.val.via.bin.size;
+                return reinterpret_cast<const unsigned char*>(kv.val.via.bin.ptr);
+            }
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Copy the value of a key into a fixed size buffer, same checks as extractValueFromMap.
+ *
+ * @param key
+ * @param output
+ * @param size Expected size of the value
+ * @return true if the key exists with the expected size
+ */
+bool MsgView::extract(const char *key, unsigned char *output, size_t size) const {
+    size_t valueSize = 0;
+    const unsigned char *value = find(key, valueSize);
+    if (value == nullptr) {
+        std::cerr << "Error: key " << key << " not found.\n";
+        return false;
+    }
+    if (valueSize != size) {
+        std::cerr << "Error: value has incorrect size (" << valueSize << ").\n";
+        return false;
+    }
+    std::memcpy(output, value, size);
+    return true;
+}
+
+/// @brief Get the id of the sender, empty if there is none
+std::string MsgView::getId() const {
+    if (kind == FRAME) {
+        return wireId(*frame);
+    }
+    size_t size = 0;
+    const unsigned char *id = find("id", size);
+    return id == nullptr ? std::string() : std::string(reinterpret_cast<const char*>(id), size);
+}
+
+/**
+ * @brief Copy the message into a map, for the code paths that need to keep it.
+ *
+ * @param msg
+ */
+void MsgView::toMap(std::unordered_map<std::string, std::string> &msg) const {
+    if (kind == FRAME) {
+        wireToMap(*frame, msg);
+    }
+    else if (kind == MSGPACK) {
+        const msgpack::object &obj = handle.get();
+        for (uint32_t i = 0; i < obj.via.map.size; ++i) {
+            const msgpack::object_kv& kv = obj.via.map.ptr[i];
+            msg.emplace(kv.key.as<std::string>(), kv.val.as<std::string>());
+        }
+    }
+}
+
+/// @brief Print the content of the message, see printMsg
+void MsgView::print() const {
+    std::unordered_map<std::string, std::string> msg;
+    toMap(msg);
+    printMsg(msg);
+}
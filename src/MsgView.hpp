@@ -0,0 +1,50 @@
+/**
+ * @file MsgView.hpp
+ * @brief MsgView class header
+ *
+ * This file holds the MsgView class header. A MsgView is a received message whose keys and values
+ * are not copied : they point straight into the receive buffer of the SocketModule that filled it.
+ *
+ */
+
+#ifndef MSGVIEW_HPP
+#define MSGVIEW_HPP
+
+#include <string>
+#include <unordered_map>
+#include <msgpack.hpp>
+
+#include "utils.hpp"
+#include "WireFormat.hpp"
+
+class SocketModule;
+
+/// @brief Read-only view of a received message, msgPack map or binary frame.
+/// It stays valid until the next receive on the socket that filled it.
+class MsgView {
+    friend class SocketModule;
+
+private:
+    enum Kind { EMPTY, MSGPACK, FRAME } kind;
+    msgpack::object_handle handle;      // Keeps the msgPack data alive
+    const WireFrame *frame;             // Points into the unpacker buffer
+
+public:
+    MsgView();
+
+    // Delete copy constructor and copy assignment operator
+    MsgView(const MsgView&) = delete;
+    MsgView& operator=(const MsgView&) = delete;
+
+    void clear();
+    bool empty() const;
+
+    const unsigned char* find(const char *key, size_t &size) const;
+    bool extract(const char *key, unsigned char *output, size_t size) const;
+    std::string getId() const;
+
+    void toMap(std::unordered_map<std::string, std::string> &msg) const;
+    void print() const;
+};
+
+#endif
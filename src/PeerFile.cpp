@@ -0,0 +1,404 @@
+/**
+ * @file PeerFile.cpp
+ * @brief PeerFile class implementation
+ *
+ * This file holds the PeerFile class implementation. Both files use the native byte order : they are
+ * meant to be read back by the UAV that wrote them.
+ *
+ */
+
+#include "PeerFile.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <vector>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char PEER_FILE_MAGIC[8] = {'S', 'P', 'K', 'P', 'E', 'E', 'R', 'S'};
+
+/// @brief Start of the snapshot file. The salt of the simulated PUF is kept with the peers : a real PUF
+/// answers the same after a reboot, the simulated one needs its salt back for that.
+struct PeerFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t count;
+    unsigned char salt[PUF_SIZE];
+    uint64_t checksum;          // Of the records
+};
+
+enum JournalOp : uint8_t {
+    JOURNAL_SAVE = 1,
+    JOURNAL_REMOVE = 2
+};
+
+/// @brief One change appended to the journal. An entry cut by a crash fails its checksum and is dropped.
+struct JournalEntry {
+    uint8_t op;
+    PeerRecord record;
+    uint64_t checksum;          // Of everything before it
+};
+
+/// @brief FNV-1a over a buffer
+static uint64_t checksum(const void *data, size_t size, uint64_t h = 0xcbf29ce484222325ULL) {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/// @brief Write a whole buffer, retrying on short writes
+static bool writeAll(int fd, const void *data, size_t size) {
+    const char *bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, bytes, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/// @brief Make a rename in the directory of path durable
+static void syncDirectory(const std::string &path) {
+    std::vector<char> copy(path.begin(), path.end());
+    copy.push_back('\0');
+    int fd = open(dirname(copy.data()), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief Open the files of a PeerFile, creating them with a new PUF salt when they do not exist.
+ *
+ * @param path Snapshot file
+ * @param sync Wait for every change to reach the disk. Without it a crash of the machine, not of the process, may lose the last changes.
+ */
+PeerFile::PeerFile(const std::string &path, bool sync)
+    : path(path), journalPath(path + ".journal"), sync(sync), journal_fd(-1), journalEntries(0), salt{} {
+    // Replaced by the saved salt if the snapshot exists, kept if the file cannot be used
+    generate_random_bytes(salt, PUF_SIZE);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        PeerFileHeader header;
+        ssize_t n = pread(fd, &header, sizeof(header), 0);
+        close(fd);
+        if (n != static_cast<ssize_t>(sizeof(header)) || memcmp(header.magic, PEER_FILE_MAGIC, sizeof(PEER_FILE_MAGIC)) != 0
+            || header.version != PEER_FILE_VERSION || header.recordSize != sizeof(PeerRecord)) {
+            std::cerr << "Error: " << path << " is not a peer file of this version." << std::endl;
+            return;
+        }
+        memcpy(salt, header.salt, PUF_SIZE);
+    }
+    else if (errno == ENOENT) {
+        if (!writeSnapshot(nullptr)) {
+            return;
+        }
+    }
+    else {
+        perror("Opening the peer file failed");
+        return;
+    }
+
+    journal_fd = open(journalPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0600);
+    if (journal_fd < 0) {
+        perror("Opening the peer journal failed");
+    }
+}
+
+PeerFile::~PeerFile() {
+    if (journal_fd >= 0) {
+        close(journal_fd);
+    }
+}
+
+bool PeerFile::isOpen() const {
+    return journal_fd >= 0;
+}
+
+/**
+ * @brief Salt of the simulated PUF of the UAV owning the file.
+ *
+ * @return PUF_SIZE bytes
+ */
+const unsigned char* PeerFile::getSalt() const {
+    return salt;
+}
+
+/**
+ * @brief Write the UAVs of a store, or none, to a new snapshot replacing the current one.
+ *
+ * @param store nullptr for an empty snapshot
+ * @return false on failure, the current snapshot is then left untouched
+ */
+bool PeerFile::writeSnapshot(const PeerStore *store) {
+    std::vector<PeerRecord> records;
+    if (store != nullptr) {
+        records.reserve(store->size());
+        store->forEach([&](const std::string &id, const UAVData &data) {
+            if (id.size() > PEER_ID_SIZE) {
+                std::cerr << "Error: id " << id << " is too long to be saved." << std::endl;
+                return;
+            }
+            PeerRecord record;
+            memset(static_cast<void*>(&record), 0, sizeof(record));
+            record.idLength = static_cast<uint8_t>(id.size());
+            memcpy(record.id, id.data(), id.size());
+            record.data = data;
+            records.push_back(record);
+        });
+    }
+
+    std::string tmpPath = path + ".tmp";
+    int fd = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        perror("Creating the peer snapshot failed");
+        return false;
+    }
+
+    size_t size = sizeof(PeerFileHeader) + records.size() * sizeof(PeerRecord);
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        perror("Sizing the peer snapshot failed");
+        close(fd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("Mapping the peer snapshot failed");
+        close(fd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    PeerFileHeader *header = static_cast<PeerFileHeader*>(map);
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, PEER_FILE_MAGIC, sizeof(PEER_FILE_MAGIC));
+    header->version = PEER_FILE_VERSION;
+    header->recordSize = sizeof(PeerRecord);
+    header->count = records.size();
+    memcpy(header->salt, salt, PUF_SIZE);
+
+    unsigned char *body = static_cast<unsigned char*>(map) + sizeof(PeerFileHeader);
+    if (!records.empty()) {
+        memcpy(body, records.data(), records.size() * sizeof(PeerRecord));
+    }
+    header->checksum = checksum(body, records.size() * sizeof(PeerRecord));
+
+    bool ok = !sync || msync(map, size, MS_SYNC) == 0;
+    munmap(map, size);
+    close(fd);
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        perror("Saving the peer snapshot failed");
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    if (sync) {
+        syncDirectory(path);
+    }
+    return true;
+}
+
+/**
+ * @brief Put the UAVs of the snapshot and of the journal in a store.
+ * A journal entry cut by a crash is dropped along with anything after it.
+ * A corrupted snapshot is renamed with the ".corrupt" suffix, only the journal is loaded then.
+ *
+ * @param store
+ * @return false if the snapshot was corrupted
+ */
+bool PeerFile::load(PeerStore &store) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!isOpen()) {
+        return false;
+    }
+    bool intact = true;
+
+    // Snapshot
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(PeerFileHeader)) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            const PeerFileHeader *header = static_cast<const PeerFileHeader*>(map);
+            const PeerRecord *records = reinterpret_cast<const PeerRecord*>(static_cast<const unsigned char*>(map) + sizeof(PeerFileHeader));
+            // Checked before multiplying, so a corrupted count cannot wrap around
+            bool valid = header->count <= (size - sizeof(PeerFileHeader)) / sizeof(PeerRecord);
+            size_t bytes = valid ? static_cast<size_t>(header->count) * sizeof(PeerRecord) : 0;
+            for (uint64_t i = 0; valid && i < header->count; i++) {
+                valid = records[i].idLength <= PEER_ID_SIZE;
+            }
+
+            if (!valid || checksum(records, bytes) != header->checksum) {
+                intact = false;
+            } else {
+                store.reserve(header->count);
+                for (uint64_t i = 0; i < header->count; i++) {
+                    if (store.insert(std::string(records[i].id, records[i].idLength), records[i].data) == PEER_NONE) {
+                        std::cerr << "Error: no room left in the UAV table, " << header->count - i << " UAVs of " << path << " are not loaded." << std::endl;
+                        break;
+                    }
+                }
+            }
+            munmap(map, size);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    // Kept for a look by hand. An empty snapshot takes its place, so the salt of the PUF is not lost
+    // and the journal still applies at the next start
+    if (!intact) {
+        std::string asidePath = path + ".corrupt";
+        std::cerr << "Error: the peer snapshot " << path << " is corrupted, it is moved to " << asidePath << "." << std::endl;
+        if (rename(path.c_str(), asidePath.c_str()) != 0) {
+            perror("Moving the peer snapshot aside failed");
+        } else {
+            writeSnapshot(nullptr);
+        }
+    }
+
+    // Journal
+    if (fstat(journal_fd, &st) == 0 && st.st_size > 0) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, journal_fd, 0);
+        if (map != MAP_FAILED) {
+            const JournalEntry *entries = static_cast<const JournalEntry*>(map);
+            size_t count = size / sizeof(JournalEntry);
+            size_t valid = 0;
+
+            for (; valid < count; valid++) {
+                const JournalEntry &entry = entries[valid];
+                if (checksum(&entry, offsetof(JournalEntry, checksum)) != entry.checksum
+                    || entry.record.idLength > PEER_ID_SIZE) {
+                    break;
+                }
+                std::string id(entry.record.id, entry.record.idLength);
+                if (entry.op == JOURNAL_SAVE) {
+                    // Insert, or overwrite the value of the snapshot
+                    store.upsert(id, entry.record.data);
+                } else if (entry.op == JOURNAL_REMOVE) {
+                    store.erase(id);
+                }
+            }
+            munmap(map, size);
+
+            if (valid * sizeof(JournalEntry) != size) {
+                std::cerr << "Warning: dropped an incomplete entry at the end of " << journalPath << "." << std::endl;
+                if (ftruncate(journal_fd, static_cast<off_t>(valid * sizeof(JournalEntry))) != 0) {
+                    perror("Truncating the peer journal failed");
+                }
+            }
+            journalEntries = valid;
+        }
+    }
+
+    return intact;
+}
+
+/// @brief Append one entry to the journal and wait for it to reach the disk. The caller holds the lock.
+bool PeerFile::appendEntry(uint8_t op, const std::string &id, const UAVData &data) {
+    if (!isOpen()) {
+        return false;
+    }
+    if (id.size() > PEER_ID_SIZE) {
+        std::cerr << "Error: id " << id << " is too long to be saved." << std::endl;
+        return false;
+    }
+
+    JournalEntry entry;
+    memset(static_cast<void*>(&entry), 0, sizeof(entry));
+    entry.op = op;
+    entry.record.idLength = static_cast<uint8_t>(id.size());
+    memcpy(entry.record.id, id.data(), id.size());
+    entry.record.data = data;
+    entry.checksum = checksum(&entry, offsetof(JournalEntry, checksum));
+
+    if (!writeAll(journal_fd, &entry, sizeof(entry)) || (sync && fdatasync(journal_fd) != 0)) {
+        perror("Writing the peer journal failed");
+        return false;
+    }
+    journalEntries++;
+    return true;
+}
+
+/**
+ * @brief Save the current values of a UAV. They are read under the lock of the file : two saves of
+ * the same UAV reach the journal in the order of their reads, so the last entry holds the last values.
+ *
+ * @param store
+ * @param handle
+ * @return false if the UAV is unknown or the change could not be written
+ */
+bool PeerFile::save(const PeerStore &store, PeerHandle handle) {
+    std::lock_guard<std::mutex> guard(lock);
+    UAVData data;
+    std::string id = store.getId(handle);
+    if (id.empty() || !store.read(handle, data)) {
+        return false;
+    }
+    return appendEntry(JOURNAL_SAVE, id, data);
+}
+
+/**
+ * @brief Save the removal of a UAV.
+ *
+ * @param id
+ * @return false if the change could not be written
+ */
+bool PeerFile::remove(const std::string &id) {
+    std::lock_guard<std::mutex> guard(lock);
+    return appendEntry(JOURNAL_REMOVE, id, UAVData());
+}
+
+/**
+ * @brief Whether changes were journaled since the last snapshot.
+ *
+ * @return bool
+ */
+bool PeerFile::hasJournal() const {
+    return journalEntries > 0;
+}
+
+/**
+ * @brief Whether the journal grew enough to be folded in a new snapshot.
+ *
+ * @return bool
+ */
+bool PeerFile::needsCheckpoint() const {
+    return journalEntries >= PEER_JOURNAL_LIMIT;
+}
+
+/**
+ * @brief Write a new snapshot of the store and empty the journal.
+ *
+ * @param store
+ * @return false on failure, the journal is then kept
+ */
+bool PeerFile::checkpoint(const PeerStore &store) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!isOpen() || !writeSnapshot(&store)) {
+        return false;
+    }
+    if (ftruncate(journal_fd, 0) != 0) {
+        perror("Truncating the peer journal failed");
+        return false;
+    }
+    journalEntries = 0;
+    return true;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file PeerFile.hpp
+ * @brief PeerFile class header
+ *
+ * This file holds the PeerFile class header. A PeerFile keeps the UAV table on disk, so a UAV that
+ * restarts finds its enrolments back instead of enrolling again with every neighbour.
+ *
+ * It is made of two files :
+ *  - the snapshot, a header followed by fixed size records, read and written through mmap ;
+ *  - the journal, next to it with the ".journal" suffix, where every change made since the snapshot
+ *    is appended and synced before the protocol goes on.
+ * Loading maps the snapshot and replays the journal. A checkpoint writes a new snapshot beside the
+ * old one, renames it over the old one and empties the journal, so a crash at any point leaves
+ * either the old or the new state on disk. A corrupted snapshot is moved aside with the ".corrupt"
+ * suffix, never overwritten.
+ *
+ */
+
+#ifndef PEERFILE_HPP
+#define PEERFILE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "PeerStore.hpp"
+
+#define PEER_FILE_VERSION 1
+#define PEER_ID_SIZE 31
+// Journal entries after which the UAV writes a new snapshot
+#define PEER_JOURNAL_LIMIT 4096
+
+/// @brief One UAV as stored on disk
+struct PeerRecord {
+    uint8_t idLength;
+    char id[PEER_ID_SIZE];
+    UAVData data;
+};
+
+/// @brief UAV table stored in a snapshot file and a journal.
+class PeerFile {
+private:
+    std::string path;
+    std::string journalPath;
+    bool sync;
+
+    int journal_fd;
+    std::atomic<size_t> journalEntries;
+    unsigned char salt[PUF_SIZE];
+    std::mutex lock;
+
+    bool writeSnapshot(const PeerStore *store);
+    bool appendEntry(uint8_t op, const std::string &id, const UAVData &data);
+
+public:
+    PeerFile(const std::string &path, bool sync = true);
+    ~PeerFile();
+
+    // Delete copy constructor and copy assignment operator
+    PeerFile(const PeerFile&) = delete;
+    PeerFile& operator=(const PeerFile&) = delete;
+
+    bool isOpen() const;
+    const unsigned char* getSalt() const;
+
+    bool load(PeerStore &store);
+
+    bool save(const PeerStore &store, PeerHandle handle);
+    bool remove(const std::string &id);
+
+    bool hasJournal() const;
+    bool needsCheckpoint() const;
+    bool checkpoint(const PeerStore &store);
+};
+
+#endif
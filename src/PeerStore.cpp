@@ -0,0 +1,202 @@
+/**
+ * @file PeerStore.cpp
+ * @brief PeerStore class implementation
+ *
+ * This file holds the PeerStore class implementation.
+ *
+ */
+
+#include "PeerStore.hpp"
+
+/// @brief The PeerTable of a shard picks its slot from the low bits of the key, the shard uses the high ones
+unsigned PeerStore::shardOf(uint64_t key) {
+    return static_cast<unsigned>(key >> (64 - PEER_SHARD_BITS));
+}
+
+/// @brief Global handle of the local handle of a shard
+PeerHandle PeerStore::encode(unsigned shard, PeerHandle local) {
+    if (local == PEER_NONE || local >= (1u << PEER_LOCAL_BITS) - 1) {
+        return PEER_NONE;
+    }
+    return (static_cast<PeerHandle>(shard) << PEER_LOCAL_BITS) | local;
+}
+
+/**
+ * @brief Add a UAV. A UAV already in the store is left untouched.
+ *
+ * @param id
+ * @param data
+ * @return PeerHandle of the UAV, PEER_NONE if its shard is full : nothing is added then
+ */
+PeerHandle PeerStore::insert(const std::string &id, const UAVData &data) {
+    uint64_t key = PeerTable::peerKey(id);
+    unsigned shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shards[shard].lock);
+    return encode(shard, shards[shard].table.insert(key, id, data));
+}
+
+/**
+ * @brief Add a UAV, or replace the whole data of a UAV already in the store.
+ *
+ * @param id
+ * @param data
+ * @return PeerHandle of the UAV, PEER_NONE if its shard is full : nothing is added then
+ */
+PeerHandle PeerStore::upsert(const std::string &id, const UAVData &data) {
+    uint64_t key = PeerTable::peerKey(id);
+    unsigned shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shards[shard].lock);
+    PeerHandle local = shards[shard].table.insert(key, id, data);
+    UAVData *record = shards[shard].table.get(local);
+    if (record == nullptr) {
+        return PEER_NONE;
+    }
+    *record = data;
+    return encode(shard, local);
+}
+
+/**
+ * @brief Look a UAV up.
+ *
+ * @param id
+ * @return PeerHandle, PEER_NONE if the UAV is unknown
+ */
+PeerHandle PeerStore::find(const std::string &id) const {
+    uint64_t key = PeerTable::peerKey(id);
+    unsigned shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shards[shard].lock);
+    return encode(shard, shards[shard].table.find(key, id));
+}
+
+/**
+ * @brief Remove a UAV.
+ *
+ * @param id
+ * @return true if the UAV was in the store
+ */
+bool PeerStore::erase(const std::string &id) {
+    uint64_t key = PeerTable::peerKey(id);
+    unsigned shard = shardOf(key);
+    std::lock_guard<std::mutex> guard(shards[shard].lock);
+    return shards[shard].table.erase(key, id);
+}
+
+/**
+ * @brief Copy the data of a UAV, consistent even while other threads commit.
+ *
+ * @param handle
+ * @param data Left untouched if the UAV is unknown
+ * @return false if the UAV is unknown
+ */
+bool PeerStore::read(PeerHandle handle, UAVData &data) const {
+    if (handle == PEER_NONE) {
+        return false;
+    }
+    const Shard &shard = shards[handle >> PEER_LOCAL_BITS];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    const UAVData *record = shard.table.get(handle & ((1u << PEER_LOCAL_BITS) - 1));
+    if (record == nullptr) {
+        return false;
+    }
+    data = *record;
+    return true;
+}
+
+/**
+ * @brief Store the new x and R of a UAV at the end of an authentication, both at once.
+ * Two authentications of the same UAV can run concurrently, only the first one to commit wins :
+ * the commit fails if R is not expectedR anymore.
+ *
+ * @param handle
+ * @param expectedR R the authentication started from, nullptr to skip the check
+ * @param newX
+ * @param newR
+ * @return false if the UAV is unknown or its R changed
+ */
+bool PeerStore::commit(PeerHandle handle, const unsigned char *expectedR, const unsigned char *newX, const unsigned char *newR) {
+    if (handle == PEER_NONE) {
+        return false;
+    }
+    Shard &shard = shards[handle >> PEER_LOCAL_BITS];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    UAVData *record = shard.table.get(handle & ((1u << PEER_LOCAL_BITS) - 1));
+    if (record == nullptr) {
+        return false;
+    }
+    if (expectedR != nullptr && (record->getR() == nullptr || memcmp(record->getR(), expectedR, PUF_SIZE) != 0)) {
+        return false;
+    }
+    record->setX(newX);
+    record->setR(newR);
+    return true;
+}
+
+/**
+ * @brief Change the data of a UAV under the lock of its shard, so that no other thread sees it half done.
+ *
+ * @param handle
+ * @param change Called with the record, it must not use the store
+ * @return false if the UAV is unknown
+ */
+bool PeerStore::update(PeerHandle handle, const std::function<void(UAVData &data)> &change) {
+    if (handle == PEER_NONE) {
+        return false;
+    }
+    Shard &shard = shards[handle >> PEER_LOCAL_BITS];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    UAVData *record = shard.table.get(handle & ((1u << PEER_LOCAL_BITS) - 1));
+    if (record == nullptr) {
+        return false;
+    }
+    change(*record);
+    return true;
+}
+
+/**
+ * @brief Get the id of a UAV from its handle.
+ *
+ * @param handle
+ * @return std::string, empty if the UAV is unknown
+ */
+std::string PeerStore::getId(PeerHandle handle) const {
+    if (handle == PEER_NONE) {
+        return std::string();
+    }
+    const Shard &shard = shards[handle >> PEER_LOCAL_BITS];
+    std::lock_guard<std::mutex> guard(shard.lock);
+    PeerHandle local = handle & ((1u << PEER_LOCAL_BITS) - 1);
+    return shard.table.get(local) != nullptr ? shard.table.getId(local) : std::string();
+}
+
+/**
+ * @brief Call a function on every UAV, one shard at a time. Each shard is locked while it is visited.
+ *
+ * @param visit
+ */
+void PeerStore::forEach(const std::function<void(const std::string &id, const UAVData &data)> &visit) const {
+    for (const Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.table.forEach(visit);
+    }
+}
+
+size_t PeerStore::size() const {
+    size_t count = 0;
+    for (const Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        count += shard.table.size();
+    }
+    return count;
+}
+
+/**
+ * @brief Size every shard for its part of a number of UAVs.
+ *
+ * @param peers
+ */
+void PeerStore::reserve(size_t peers) {
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.table.reserve(peers / PEER_SHARDS + 1);
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * @file PeerStore.hpp
+ * @brief PeerStore class header
+ *
+ * This file holds the PeerStore class header. The PeerStore is the thread-safe table of the UAVs
+ * known by a UAV : the UAVs are spread over PEER_SHARDS PeerTables by the high bits of their key,
+ * each behind its own lock, so workers authenticating different UAVs rarely wait for each other.
+ *
+ */
+
+#ifndef PEERSTORE_HPP
+#define PEERSTORE_HPP
+
+#include <mutex>
+#include <string>
+
+#include "PeerTable.hpp"
+
+#define PEER_SHARD_BITS 4
+#define PEER_SHARDS (1u << PEER_SHARD_BITS)
+#define PEER_LOCAL_BITS (32 - PEER_SHARD_BITS)
+
+static_assert(PEER_HANDLE_BITS <= PEER_LOCAL_BITS, "The handles of a PeerTable have to fit below the shard bits");
+
+/// @brief Sharded PeerTable. A PeerHandle holds the shard in its high bits and the handle inside
+/// the shard in the others. Records never move, so handles stay valid while other UAVs are added.
+class PeerStore {
+private:
+    struct Shard {
+        mutable std::mutex lock;
+        PeerTable table;
+    };
+
+    Shard shards[PEER_SHARDS];
+
+    static unsigned shardOf(uint64_t key);
+    static PeerHandle encode(unsigned shard, PeerHandle local);
+
+public:
+    PeerHandle insert(const std::string &id, const UAVData &data);
+    PeerHandle upsert(const std::string &id, const UAVData &data);
+    PeerHandle find(const std::string &id) const;
+    bool erase(const std::string &id);
+
+    bool read(PeerHandle handle, UAVData &data) const;
+    bool commit(PeerHandle handle, const unsigned char *expectedR, const unsigned char *newX, const unsigned char *newR);
+    bool update(PeerHandle handle, const std::function<void(UAVData &data)> &change);
+
+    std::string getId(PeerHandle handle) const;
+
+    void forEach(const std::function<void(const std::string &id, const UAVData &data)> &visit) const;
+
+    size_t size() const;
+    void reserve(size_t peers);
+};
+
+#endif
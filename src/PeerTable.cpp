@@ -0,0 +1,263 @@
+/**
+ * @file PeerTable.cpp
+ * @brief PeerTable class implementation
+ *
+ * This file holds the PeerTable class implementation. Removals shift the following slots back
+ * instead of leaving tombstones, so a lookup never scans more than the run of its own key.
+ *
+ */
+
+#include "PeerTable.hpp"
+
+#define PEER_INDEX_MASK ((1u << PEER_INDEX_BITS) - 1)
+#define PEER_GENERATION_MASK ((1u << PEER_GENERATION_BITS) - 1)
+// The last index is never given, so no handle is all ones
+#define PEER_INDEX_LIMIT PEER_INDEX_MASK
+
+/**
+ * @brief Construct a new empty PeerTable.
+ *
+ * @param capacity Number of slots, rounded up to a power of two
+ */
+PeerTable::PeerTable(size_t capacity) : mask(0), count(0), used(0) {
+    size_t size = 16;
+    while (size < capacity) size <<= 1;
+    rehash(size);
+}
+
+/**
+ * @brief 64 bits key of an id : FNV-1a, then mixed so that the low bits used as slot index are spread.
+ *
+ * @param id
+ * @return uint64_t
+ */
+uint64_t PeerTable::peerKey(const std::string &id) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char ch : id) {
+        h ^= ch;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/// @brief Record of an index below used
+PeerTable::Record& PeerTable::recordAt(uint32_t index) const {
+    return chunks[index / PEER_CHUNK_RECORDS][index % PEER_CHUNK_RECORDS];
+}
+
+/// @brief Record of a handle, nullptr if the handle is PEER_NONE, out of range or of a removed peer
+PeerTable::Record* PeerTable::lookup(PeerHandle handle) const {
+    if (handle == PEER_NONE) {
+        return nullptr;
+    }
+    uint32_t index = handle & PEER_INDEX_MASK;
+    if (index >= used) {
+        return nullptr;
+    }
+    Record &record = recordAt(index);
+    if (!record.live || record.generation != (handle >> PEER_INDEX_BITS)) {
+        return nullptr;
+    }
+    return &record;
+}
+
+/// @brief Slot holding the id, or the empty slot ending its run
+size_t PeerTable::findSlot(uint64_t key, const std::string &id) const {
+    size_t i = key & mask;
+    while (slots[i].handle != PEER_NONE) {
+        if (slots[i].key == key && recordAt(slots[i].handle & PEER_INDEX_MASK).id == id) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/// @brief Move every entry to a new array of the given number of slots
+void PeerTable::rehash(size_t capacity) {
+    std::vector<Slot> old;
+    old.swap(slots);
+
+    slots.assign(capacity, Slot{0, PEER_NONE});
+    mask = capacity - 1;
+
+    for (const Slot &slot : old) {
+        if (slot.handle == PEER_NONE) continue;
+        size_t i = slot.key & mask;
+        while (slots[i].handle != PEER_NONE) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
+
+/**
+ * @brief Add a UAV. Like std::unordered_map::emplace, a UAV already in the table is left untouched.
+ *
+ * @param id
+ * @param data
+ * @return PeerHandle of the UAV, PEER_NONE if the table has no handle left : nothing is added then
+ */
+PeerHandle PeerTable::insert(const std::string &id, const UAVData &data) {
+    return insert(peerKey(id), id, data);
+}
+
+PeerHandle PeerTable::insert(uint64_t key, const std::string &id, const UAVData &data) {
+    size_t i = findSlot(key, id);
+    if (slots[i].handle != PEER_NONE) {
+        return slots[i].handle;
+    }
+    if (freeRecords.empty() && used >= PEER_INDEX_LIMIT) {
+        return PEER_NONE;
+    }
+
+    // Keep the load under 3/4
+    if ((count + 1) * 4 > slots.size() * 3) {
+        rehash(slots.size() * 2);
+        i = findSlot(key, id);
+    }
+
+    // Reuse the record of a removed peer, or take the next one
+    uint32_t index;
+    if (!freeRecords.empty()) {
+        index = freeRecords.front();
+        freeRecords.pop_front();
+    } else {
+        index = static_cast<uint32_t>(used);
+        if (index % PEER_CHUNK_RECORDS == 0) {
+            chunks.emplace_back(new Record[PEER_CHUNK_RECORDS]);
+        }
+        used++;
+    }
+
+    Record &record = recordAt(index);
+    record.data = data;
+    record.id = id;
+    record.live = true;
+    PeerHandle handle = (record.generation << PEER_INDEX_BITS) | index;
+
+    slots[i].key = key;
+    slots[i].handle = handle;
+    count++;
+    return handle;
+}
+
+/**
+ * @brief Look a UAV up.
+ *
+ * @param id
+ * @return PeerHandle, PEER_NONE if the UAV is unknown
+ */
+PeerHandle PeerTable::find(const std::string &id) const {
+    return find(peerKey(id), id);
+}
+
+PeerHandle PeerTable::find(uint64_t key, const std::string &id) const {
+    return slots[findSlot(key, id)].handle;
+}
+
+/**
+ * @brief Remove a UAV. Its record is reused by a later insert, under a handle of the next generation.
+ *
+ * @param id
+ * @return true if the UAV was in the table
+ */
+bool PeerTable::erase(const std::string &id) {
+    return erase(peerKey(id), id);
+}
+
+bool PeerTable::erase(uint64_t key, const std::string &id) {
+    size_t i = findSlot(key, id);
+    PeerHandle handle = slots[i].handle;
+    if (handle == PEER_NONE) {
+        return false;
+    }
+
+    uint32_t index = handle & PEER_INDEX_MASK;
+    Record &record = recordAt(index);
+    record.data = UAVData();
+    record.id.clear();
+    record.id.shrink_to_fit();
+    record.live = false;
+    record.generation = (record.generation + 1) & PEER_GENERATION_MASK;
+    freeRecords.push_back(index);
+    count--;
+
+    // Shift back the entries that would not be found anymore behind the hole
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (slots[j].handle == PEER_NONE) break;
+        size_t home = slots[j].key & mask;
+        bool movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+        if (movable) {
+            slots[i] = slots[j];
+            i = j;
+        }
+    }
+    slots[i].handle = PEER_NONE;
+    return true;
+}
+
+/**
+ * @brief Get the data of a UAV from its handle.
+ *
+ * @param handle
+ * @return UAVData*, nullptr for PEER_NONE or a removed UAV
+ */
+UAVData* PeerTable::get(PeerHandle handle) {
+    Record *record = lookup(handle);
+    return record != nullptr ? &record->data : nullptr;
+}
+
+const UAVData* PeerTable::get(PeerHandle handle) const {
+    const Record *record = lookup(handle);
+    return record != nullptr ? &record->data : nullptr;
+}
+
+/**
+ * @brief Get the id of a UAV from its handle.
+ *
+ * @param handle
+ * @return const std::string&, empty for PEER_NONE or a removed UAV
+ */
+const std::string& PeerTable::getId(PeerHandle handle) const {
+    static const std::string none;
+    const Record *record = lookup(handle);
+    return record != nullptr ? record->id : none;
+}
+
+/**
+ * @brief Call a function on every UAV of the table.
+ *
+ * @param visit
+ */
+void PeerTable::forEach(const std::function<void(const std::string &id, const UAVData &data)> &visit) const {
+    for (size_t index = 0; index < used; index++) {
+        const Record &record = recordAt(static_cast<uint32_t>(index));
+        if (record.live) {
+            visit(record.id, record.data);
+        }
+    }
+}
+
+size_t PeerTable::size() const {
+    return count;
+}
+
+/**
+ * @brief Size the table for a number of UAVs, so that adding them does not rehash.
+ *
+ * @param peers
+ */
+void PeerTable::reserve(size_t peers) {
+    size_t capacity = slots.size();
+    while (peers * 4 > capacity * 3) capacity <<= 1;
+    if (capacity != slots.size()) {
+        rehash(capacity);
+    }
+    chunks.reserve((peers + PEER_CHUNK_RECORDS - 1) / PEER_CHUNK_RECORDS);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file PeerTable.hpp
+ * @brief PeerTable class header
+ *
+ * This file holds the PeerTable class header. The PeerTable is the table of the UAVs known by a UAV.
+ * An id is hashed once to a 64 bits key and looked up in a flat open addressing array (linear probing),
+ * which gives a compact handle. The handle then reaches the record directly for the rest of the handshake.
+ *
+ */
+
+#ifndef PEERTABLE_HPP
+#define PEERTABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "UAVData.hpp"
+
+typedef uint32_t PeerHandle;
+
+#define PEER_NONE UINT32_MAX
+
+// A handle is the index of the record and the generation of that record : 28 bits, leaving the high bits to the shards of PeerStore
+#define PEER_INDEX_BITS 20
+#define PEER_GENERATION_BITS 8
+#define PEER_HANDLE_BITS (PEER_INDEX_BITS + PEER_GENERATION_BITS)
+#define PEER_CHUNK_RECORDS 256
+
+/// @brief Map from UAV ids to UAVData. The records are stored in chunks that never move : handles and UAVData
+/// pointers stay valid until the peer is removed. The record of a removed peer is reused with a new generation,
+/// so a handle kept by a running handshake finds nothing once its peer is removed, instead of the data of another UAV.
+class PeerTable {
+private:
+    struct Slot {
+        uint64_t key;
+        PeerHandle handle;      // PEER_NONE when the slot is empty
+    };
+
+    struct Record {
+        UAVData data;
+        std::string id;
+        uint32_t generation = 0;
+        bool live = false;
+    };
+
+    std::vector<Slot> slots;
+    size_t mask;
+    size_t count;
+
+    std::vector<std::unique_ptr<Record[]>> chunks;
+    size_t used;                        // Records given at least once, the others are not built yet
+    std::deque<uint32_t> freeRecords;   // Records of removed peers, the oldest one is reused first
+
+    Record& recordAt(uint32_t index) const;
+    Record* lookup(PeerHandle handle) const;
+    size_t findSlot(uint64_t key, const std::string &id) const;
+    void rehash(size_t capacity);
+
+public:
+    explicit PeerTable(size_t capacity = 16);
+
+    static uint64_t peerKey(const std::string &id);
+
+    PeerHandle insert(const std::string &id, const UAVData &data);
+    PeerHandle find(const std::string &id) const;
+    bool erase(const std::string &id);
+
+    // Same, with the key already computed by peerKey()
+    PeerHandle insert(uint64_t key, const std::string &id, const UAVData &data);
+    PeerHandle find(uint64_t key, const std::string &id) const;
+    bool erase(uint64_t key, const std::string &id);
+
+    UAVData* get(PeerHandle handle);
+    const UAVData* get(PeerHandle handle) const;
+    const std::string& getId(PeerHandle handle) const;
+
+    void forEach(const std::function<void(const std::string &id, const UAVData &data)> &visit) const;
+
+    size_t size() const;
+    void reserve(size_t peers);
+};
+
+#endif
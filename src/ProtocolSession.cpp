@@ -0,0 +1,878 @@
+/**
+ * @file ProtocolSession.cpp
+ * @brief ProtocolSession classes implementation
+ *
+ * This file holds the resumable versions of the UAV protocols, split at every point where a UAV waits
+ * for its peer. The blocking functions of UAV.cpp run them with runSession().
+ *
+ */
+
+#include "ProtocolSession.hpp"
+
+#ifdef MEASUREMENTS_DETAILLED
+/// @brief Add the cycles of one run of a protocol to its histograms
+/// @param protocol e.g. "authentication.client"
+/// @param opCycles 
+/// @param idlCycles 
+static void recordCycles(const char * protocol, long long opCycles, long long idlCycles){
+    std::string name(protocol);
+    LatencyHistogram::named(name + ".op").record(opCycles);
+    LatencyHistogram::named(name + ".idle").record(idlCycles);
+    LatencyHistogram::named(name + ".total").record(opCycles + idlCycles);
+}
+#endif
+
+/// @brief Constructor
+ProtocolSession::ProtocolSession(UAV &uav, const std::string &peerId)
+    : uav(uav), peerId(peerId), peerHandle(PEER_NONE), result(-1), done(false) {}
+
+/// @brief Destructor
+ProtocolSession::~ProtocolSession() {}
+
+/// @brief Initiators emit their first message here. Responders have nothing to send.
+/// @param out
+void ProtocolSession::start(std::vector<ProtocolMessage> &out) {
+    (void)out;
+}
+
+/// @brief The peer did not answer in time. By default the session is aborted.
+/// @param out
+void ProtocolSession::onTimeout(std::vector<ProtocolMessage> &out) {
+    (void)out;
+    std::cerr << "Error occurred: content is empty!" << std::endl;
+    finish(-1);
+}
+
+/// @brief Mark the session as finished with the given result.
+/// @param result
+void ProtocolSession::finish(int result) {
+    this->result = result;
+    this->done = true;
+}
+
+/// @brief Take the peer id from a received message, which keys the peer in the UAV table. Once known, every
+/// following message has to carry the same id.
+/// @param in
+/// @return false if the message has no id, or not the one of the peer
+bool ProtocolSession::learnPeer(const ProtocolMessage &in) {
+    auto it = in.find("id");
+    if (it == in.end() || it->second.empty()) {
+        std::cerr << "Error occurred: the message has no id!" << std::endl;
+        return false;
+    }
+    if (peerId.empty()) {
+        peerId = it->second;
+        return true;
+    }
+    if (it->second != peerId) {
+        std::cerr << "Error occurred: expected a message from " << peerId << ", got one from " << it->second << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// @brief Copy the data of the peer from the UAV table : other sessions may update the same UAV from other
+/// threads. The id is only looked up until the peer is found, then its handle is used for the rest of the session.
+/// @param data
+/// @return false if the peer is unknown
+bool ProtocolSession::readPeer(UAVData &data) {
+    if (uav.readUAV(peerHandle, data)) {
+        return true;
+    }
+    peerHandle = uav.findUAV(peerId);
+    return uav.readUAV(peerHandle, data);
+}
+
+/// @brief Change the data of the peer under the lock of the UAV table.
+/// @param change
+/// @return false if the peer is unknown
+bool ProtocolSession::updatePeer(const std::function<void(UAVData &data)> &change) {
+    if (uav.updateUAV(peerHandle, change)) {
+        return true;
+    }
+    peerHandle = uav.findUAV(peerId);
+    return uav.updateUAV(peerHandle, change);
+}
+
+/// @brief Create a message already holding the id of this UAV.
+ProtocolMessage ProtocolSession::newMessage() const {
+    ProtocolMessage msg;
+    msg.reserve(4);
+    msg.emplace("id", uav.getId());
+    return msg;
+}
+
+bool ProtocolSession::isDone() const { return done; }
+int ProtocolSession::getResult() const { return result; }
+const std::string& ProtocolSession::getPeerId() const { return peerId; }
+
+// Enrolment
+
+EnrolmentClientSession::EnrolmentClientSession(UAV &uav) : ProtocolSession(uav, ""), state(START) {}
+
+/// @brief A computes the challenge for B and sends CB. xB is saved once B answered with its id.
+void EnrolmentClientSession::start(std::vector<ProtocolMessage> &out) {
+    TRACE_PHASE(span, "enrol.client.send_CB");
+    generate_random_bytes(xB, PUF_SIZE);
+
+    unsigned char CB[PUF_SIZE];
+    uav.callPUF(xB, CB);
+
+    ProtocolMessage msg = newMessage();
+    msg.emplace("CB", std::string(reinterpret_cast<const char*>(CB), PUF_SIZE));
+    out.push_back(std::move(msg));
+    state = AWAIT_RB;
+}
+
+void EnrolmentClientSession::onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) {
+    if (!learnPeer(in)) {
+        finish(-1);
+        return;
+    }
+
+    if (state == AWAIT_RB) {
+        TRACE_PHASE(span, "enrol.client.store_RB");
+        unsigned char RB[PUF_SIZE];
+        if (!extractValueFromMap(in, "RB", RB, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+        // Creates B in the memory of A, under the id B answers with, and save xB and B's response
+        peerHandle = uav.setUAV(peerId, xB, nullptr, RB);
+        if (peerHandle == PEER_NONE) {
+            finish(-1);
+            return;
+        }
+        PROD_ONLY({std::cout << peerId << " is enroled to " << uav.getId() << "\n";});
+        state = AWAIT_CA;
+
+        // A pipelined server sends CA along with RB
+        if (in.find("CA") == in.end()) {
+            return;
+        }
+    }
+    if (state == AWAIT_CA) {
+        TRACE_PHASE(span, "enrol.client.send_RA");
+        // A saves CA and answers with RA
+        unsigned char CA[PUF_SIZE];
+        if (!extractValueFromMap(in, "CA", CA, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+        if (!updatePeer([&](UAVData &peer) { peer.setC(CA); })) {
+            finish(-1);
+            return;
+        }
+        uav.saveUAV(peerHandle);
+
+        unsigned char RA[PUF_SIZE];
+        uav.callPUF(CA, RA);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("RA", std::string(reinterpret_cast<const char*>(RA), PUF_SIZE));
+        out.push_back(std::move(msg));
+        state = FINISHED;
+        finish(0);
+    }
+}
+
+EnrolmentServerSession::EnrolmentServerSession(UAV &uav, bool pipelined)
+    : ProtocolSession(uav, ""), state(AWAIT_CB), pipelined(pipelined) {}
+
+void EnrolmentServerSession::onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) {
+    if (!learnPeer(in)) {
+        finish(-1);
+        return;
+    }
+
+    if (state == AWAIT_CB) {
+        TRACE_PHASE(span, "enrol.server.send_RB_CA");
+        // B receive CB. It creates A in the memory of B and save CB.
+        unsigned char CB[PUF_SIZE];
+        if (!extractValueFromMap(in, "CB", CB, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+        // B enroll with A : it creates xA, saved along with CB
+        unsigned char xA[PUF_SIZE];
+        generate_random_bytes(xA, PUF_SIZE);
+        peerHandle = uav.setUAV(peerId, xA, CB);
+        if (peerHandle == PEER_NONE) {
+            finish(-1);
+            return;
+        }
+
+        // B answers with RB
+        unsigned char RB[PUF_SIZE];
+        uav.callPUF(CB, RB);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("RB", std::string(reinterpret_cast<const char*>(RB), PUF_SIZE));
+
+        // B sends the challenge CA, in the same message when pipelined
+        unsigned char CA[PUF_SIZE];
+        uav.callPUF(xA, CA);
+
+        if (!pipelined) {
+            out.push_back(std::move(msg));
+            msg = newMessage();
+        }
+        msg.emplace("CA", std::string(reinterpret_cast<const char*>(CA), PUF_SIZE));
+        out.push_back(std::move(msg));
+        state = AWAIT_RA;
+    }
+    else if (state == AWAIT_RA) {
+        TRACE_PHASE(span, "enrol.server.store_RA");
+        // B receive RA and saves it
+        unsigned char RA[PUF_SIZE];
+        if (!extractValueFromMap(in, "RA", RA, PUF_SIZE) || !updatePeer([&](UAVData &peer) { peer.setR(RA); })) {
+            finish(-1);
+            return;
+        }
+        uav.saveUAV(peerHandle);
+        PROD_ONLY({std::cout << peerId << " is enroled to " << uav.getId() << "\n";});
+        state = FINISHED;
+        finish(0);
+    }
+}
+
+// Authentication
+
+AuthenticationClientSession::AuthenticationClientSession(UAV &uav, const std::string &peerId, bool withKey)
+    : ProtocolSession(uav, peerId), state(START), withKey(withKey) {}
+
+/// @brief A generates NA and sends M0 = NA ^ CA.
+void AuthenticationClientSession::start(std::vector<ProtocolMessage> &out) {
+    TRACE_PHASE(span, "auth.client.send_M0");
+    UAVData peer;
+    if (!readPeer(peer) || peer.getC() == nullptr) {
+        PROD_ONLY({std::cout << "No expected challenge in memory for this UAV.\n";});
+        finish(1);
+        return;
+    }
+    memcpy(CA, peer.getC(), PUF_SIZE);
+
+    generate_random_bytes(NA);
+    xor_buffers(NA, CA, PUF_SIZE, M0);
+
+    ProtocolMessage msg = newMessage();
+    msg.emplace("M0", std::string(reinterpret_cast<const char*>(M0), PUF_SIZE));
+    out.push_back(std::move(msg));
+    state = AWAIT_M1;
+}
+
+/// @brief The ACK did not arrive : A keeps the current CA concealed in case B did not rotate, then rotates.
+void AuthenticationClientSession::concealAndRotate() {
+    unsigned char xLock[PUF_SIZE];
+    generate_random_bytes(xLock);
+
+    unsigned char lock[PUF_SIZE];
+    uav.callPUF(xLock, lock);
+
+    unsigned char concealedCA[PUF_SIZE];
+    xor_buffers(CA, lock, PUF_SIZE, concealedCA);
+
+    bool known = updatePeer([&](UAVData &peer) {
+        peer.setXLock(xLock);
+        peer.setSecret(concealedCA);
+        peer.setC(NB);
+    });
+    if (known) {
+        uav.saveUAV(peerHandle);
+    }
+}
+
+void AuthenticationClientSession::onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) {
+    UAVData peer;
+    if (!learnPeer(in) || !readPeer(peer)) {
+        finish(-1);
+        return;
+    }
+
+    if (state == AWAIT_M1) {
+        TRACE_PHASE(span, "auth.client.send_M2");
+        unsigned char M1[PUF_SIZE];
+        unsigned char hash1[PUF_SIZE];
+        if (!extractValueFromMap(in, "M1", M1, PUF_SIZE) || !extractValueFromMap(in, "hash1", hash1, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+
+        // A computes RA using CA in memory and retrieves NB from M1
+        unsigned char RA[PUF_SIZE];
+        uav.callPUF(CA, RA);
+        xor_buffers(M1, NA, PUF_SIZE, NB);
+        xor_buffers(NB, RA, PUF_SIZE, NB);
+
+        unsigned char hash1Check[PUF_SIZE];
+        TranscriptHash()
+            .add(CA)
+            .add(NB)
+            .add(RA)
+            .add(NA)
+            .finish(hash1Check);
+
+        if (memcmp(hash1, hash1Check, PUF_SIZE) != 0) {
+            // B may still be using the previous challenge
+            const unsigned char * xLock = peer.getXLock();
+            const unsigned char * secret = peer.getSecret();
+            if (xLock == nullptr || secret == nullptr) {
+                PROD_ONLY({std::cout << "No old challenge in memory for the requested UAV.\n";});
+                finish(1);
+                return;
+            }
+            unsigned char lock[PUF_SIZE];
+            uav.callPUF(xLock, lock);
+            unsigned char CAOld[PUF_SIZE];
+            xor_buffers(lock, secret, PUF_SIZE, CAOld);
+
+            unsigned char NAOld[PUF_SIZE];
+            xor_buffers(M0, CAOld, PUF_SIZE, NAOld);
+
+            unsigned char RAOld[PUF_SIZE];
+            uav.callPUF(CAOld, RAOld);
+
+            unsigned char NBOld[PUF_SIZE];
+            xor_buffers(M1, RAOld, PUF_SIZE, NBOld);
+            xor_buffers(NBOld, NAOld, PUF_SIZE, NBOld);
+
+            TranscriptHash()
+                .add(CAOld)
+                .add(NBOld)
+                .add(RAOld)
+                .add(NAOld)
+                .finish(hash1Check);
+
+            if (memcmp(hash1, hash1Check, PUF_SIZE) != 0) {
+                PROD_ONLY({std::cout << "Even with the old challenge, autentication has failed.\n";});
+                finish(1);
+                return;
+            }
+
+            // A will now use the values obtained with the old challenge
+            updatePeer([&](UAVData &stored) { stored.setC(CAOld); });
+            memcpy(CA, CAOld, PUF_SIZE);
+            memcpy(RA, RAOld, PUF_SIZE);
+            memcpy(NB, NBOld, PUF_SIZE);
+            memcpy(NA, NAOld, PUF_SIZE);
+        }
+
+        // A computes the new challenge and M2
+        uav.callPUF(NB, RAp);
+        unsigned char M2[PUF_SIZE];
+        xor_buffers(NA, RAp, PUF_SIZE, M2);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("M2", std::string(reinterpret_cast<const char*>(M2), PUF_SIZE));
+
+        if (withKey) {
+            // A generates S, conceals it in MK and derives K
+            unsigned char S[PUF_SIZE];
+            generate_random_bytes(S);
+
+            unsigned char MK[PUF_SIZE];
+            xor_buffers(S, NA, PUF_SIZE, MK);
+            xor_buffers(MK, NB, PUF_SIZE, MK);
+
+            deriveKeyUsingHKDF(NA, NB, S, PUF_SIZE, K);
+            msg.emplace("MK", std::string(reinterpret_cast<const char*>(MK), PUF_SIZE));
+        }
+
+        unsigned char hash2[PUF_SIZE];
+        TranscriptHash transcript;
+        transcript.add(NB).add(RA).add(RAp).add(NA);
+        if (withKey) transcript.add(K);
+        transcript.finish(hash2);
+
+        msg.emplace("hash2", std::string(reinterpret_cast<const char*>(hash2), PUF_SIZE));
+        out.push_back(std::move(msg));
+        state = AWAIT_HASH3;
+    }
+    else if (state == AWAIT_HASH3) {
+        TRACE_PHASE(span, "auth.client.check_hash3");
+        unsigned char hash3[PUF_SIZE];
+        unsigned char hash3Check[PUF_SIZE];
+        bool valid = extractValueFromMap(in, "hash3", hash3, PUF_SIZE);
+
+        if (valid) {
+            TranscriptHash transcript;
+            transcript.add(RAp);
+            if (withKey) transcript.add(K);
+            transcript.add(NB).add(NA).finish(hash3Check);
+            valid = memcmp(hash3, hash3Check, PUF_SIZE) == 0;
+        }
+
+        state = FINISHED;
+        if (!valid) {
+            concealAndRotate();
+            finish(1);
+            return;
+        }
+
+        // A saves the new challenge in CA
+        if (updatePeer([&](UAVData &stored) { stored.setC(NB); })) {
+            uav.saveUAV(peerHandle);
+        }
+        PROD_ONLY({std::cout << "\nThe two UAV autenticated each other.\n";});
+        finish(0);
+    }
+}
+
+/// @brief A timeout while waiting for the ACK is recovered like an invalid ACK.
+void AuthenticationClientSession::onTimeout(std::vector<ProtocolMessage> &out) {
+    if (state == AWAIT_HASH3) {
+        state = FINISHED;
+        concealAndRotate();
+        finish(1);
+        return;
+    }
+    ProtocolSession::onTimeout(out);
+}
+
+/// @brief Get the session key. Only meaningful once a key session succeeded.
+const unsigned char* AuthenticationClientSession::getKey() const { return K; }
+
+AuthenticationServerSession::AuthenticationServerSession(UAV &uav)
+    : ProtocolSession(uav, ""), state(AWAIT_M0), withKey(false) {}
+
+void AuthenticationServerSession::onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) {
+    if (!learnPeer(in)) {
+        finish(-1);
+        return;
+    }
+
+    UAVData stored;
+    if (!readPeer(stored)) {
+        PROD_ONLY({std::cout << "No challenge in memory for the requested UAV.\n";});
+        finish(1);
+        return;
+    }
+
+    if (state == AWAIT_M0) {
+        TRACE_PHASE(span, "auth.server.send_M1");
+        unsigned char M0[PUF_SIZE];
+        if (!extractValueFromMap(in, "M0", M0, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+
+        // B retrieve xA from memory and computes CA. The values are copied : other threads may
+        // authenticate A at the same time
+        const unsigned char * xA = stored.getX();
+        const unsigned char * storedRA = stored.getR();
+        if (xA == nullptr || storedRA == nullptr) {
+            PROD_ONLY({std::cout << "No challenge in memory for the requested UAV.\n";});
+            finish(1);
+            return;
+        }
+        memcpy(RA, storedRA, PUF_SIZE);
+
+        unsigned char CA[PUF_SIZE];
+        uav.callPUF(xA, CA);
+        xor_buffers(M0, CA, PUF_SIZE, NA);
+
+        // B then creates a nonce NB and the secret message M1
+        generate_random_bytes(gammaB);
+        uav.callPUF(gammaB, NB);
+
+        unsigned char M1[PUF_SIZE];
+        xor_buffers(RA, NA, PUF_SIZE, M1);
+        xor_buffers(M1, NB, PUF_SIZE, M1);
+
+        unsigned char hash1[PUF_SIZE];
+        TranscriptHash()
+            .add(CA)
+            .add(NB)
+            .add(RA)
+            .add(NA)
+            .finish(hash1);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("M1", std::string(reinterpret_cast<const char*>(M1), PUF_SIZE));
+        msg.emplace("hash1", std::string(reinterpret_cast<const char*>(hash1), PUF_SIZE));
+        out.push_back(std::move(msg));
+
+        // NB and RA open hash2 and fill exactly one block : hash it now rather than after M2
+        hash2Prefix.reset();
+        hash2Prefix.add(NB).add(RA);
+        state = AWAIT_M2;
+    }
+    else if (state == AWAIT_M2) {
+        TRACE_PHASE(span, "auth.server.send_hash3");
+        unsigned char M2[PUF_SIZE];
+        unsigned char hash2[PUF_SIZE];
+        if (!extractValueFromMap(in, "M2", M2, PUF_SIZE) || !extractValueFromMap(in, "hash2", hash2, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+
+        // B retrieve RAp from M2
+        unsigned char RAp[PUF_SIZE];
+        xor_buffers(M2, NA, PUF_SIZE, RAp);
+
+        // The key variant also carries MK
+        withKey = in.find("MK") != in.end();
+        if (withKey) {
+            unsigned char MK[PUF_SIZE];
+            if (!extractValueFromMap(in, "MK", MK, PUF_SIZE)) {
+                finish(-1);
+                return;
+            }
+            unsigned char S[PUF_SIZE];
+            xor_buffers(MK, NA, PUF_SIZE, S);
+            xor_buffers(S, NB, PUF_SIZE, S);
+            deriveKeyUsingHKDF(NA, NB, S, PUF_SIZE, K);
+        }
+
+        unsigned char hash2Check[PUF_SIZE];
+        TranscriptHash transcript(hash2Prefix);
+        transcript.add(RAp).add(NA);
+        if (withKey) transcript.add(K);
+        transcript.finish(hash2Check);
+
+        state = FINISHED;
+        if (memcmp(hash2, hash2Check, PUF_SIZE) != 0) {
+            PROD_ONLY({std::cout << "The hashes do not correspond.\n";});
+            finish(1);
+            return;
+        }
+
+        // B changes its values, unless another authentication of A did it first
+        if (!uav.commitUAV(peerHandle, RA, gammaB, RAp)) {
+            PROD_ONLY({std::cout << "The values of A changed during the authentication.\n";});
+            finish(1);
+            return;
+        }
+
+        // B sends a hash of RAp, (K,) NB, NA as an ACK
+        unsigned char hash3[PUF_SIZE];
+        transcript.reset();
+        transcript.add(RAp);
+        if (withKey) transcript.add(K);
+        transcript.add(NB).add(NA).finish(hash3);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("hash3", std::string(reinterpret_cast<const char*>(hash3), PUF_SIZE));
+        out.push_back(std::move(msg));
+        PROD_ONLY({std::cout << "\nThe two UAV autenticated each other.\n";});
+        finish(0);
+    }
+}
+
+bool AuthenticationServerSession::hasKey() const { return withKey; }
+const unsigned char* AuthenticationServerSession::getKey() const { return K; }
+
+// Supplementary authentication
+
+SupplementaryInitialSession::SupplementaryInitialSession(UAV &uav) : ProtocolSession(uav, ""), state(AWAIT_ID) {}
+
+void SupplementaryInitialSession::onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) {
+    // A retrieve the id of the UAV trying to connect
+    if (!learnPeer(in)) {
+        finish(-1);
+        return;
+    }
+
+    if (state == AWAIT_ID) {
+        UAVData known;
+        if (readPeer(known)) {
+            PROD_ONLY({std::cout << "UAVData found! Not supposed to happen ?! Quit.\n" << std::endl;});
+            finish(1);
+            return;
+        }
+
+        generate_random_bytes(NA);
+        ProtocolMessage msg = newMessage();
+        msg.emplace("NA", std::string(reinterpret_cast<const char*>(NA), PUF_SIZE));
+        out.push_back(std::move(msg));
+        state = AWAIT_M1;
+    }
+    else if (state == AWAIT_M1) {
+        unsigned char M1[PUF_SIZE];
+        unsigned char hash1[PUF_SIZE];
+        if (!extractValueFromMap(in, "CA", CA, PUF_SIZE) || !extractValueFromMap(in, "M1", M1, PUF_SIZE)
+            || !extractValueFromMap(in, "hash1", hash1, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+
+        // A computes RA using transmitted CA and retrieves NC
+        unsigned char RA[PUF_SIZE];
+        uav.callPUF(CA, RA);
+        xor_buffers(M1, RA, PUF_SIZE, NC);
+
+        unsigned char hash1Check[PUF_SIZE];
+        TranscriptHash()
+            .add(peerId)
+            .add(CA)
+            .add(NC)
+            .add(RA)
+            .add(NA)
+            .finish(hash1Check);
+
+        if (memcmp(hash1, hash1Check, PUF_SIZE) != 0) {
+            PROD_ONLY({std::cout << "The autentication failed.\n";});
+            finish(1);
+            return;
+        }
+
+        // A computes the new challenge and M2
+        uav.callPUF(NC, RAp);
+        unsigned char M2[PUF_SIZE];
+        xor_buffers(NC, RAp, PUF_SIZE, M2);
+
+        unsigned char hash2[PUF_SIZE];
+        TranscriptHash()
+            .add(NC)
+            .add(RA)
+            .add(RAp)
+            .add(NA)
+            .finish(hash2);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("M2", std::string(reinterpret_cast<const char*>(M2), PUF_SIZE));
+        msg.emplace("hash2", std::string(reinterpret_cast<const char*>(hash2), PUF_SIZE));
+        out.push_back(std::move(msg));
+        state = AWAIT_HASH3;
+    }
+    else if (state == AWAIT_HASH3) {
+        unsigned char hash3[PUF_SIZE];
+        unsigned char hash3Check[PUF_SIZE];
+        if (!extractValueFromMap(in, "hash3", hash3, PUF_SIZE)) {
+            onTimeout(out);
+            return;
+        }
+
+        TranscriptHash()
+            .add(RAp)
+            .add(NC)
+            .add(NA)
+            .finish(hash3Check);
+        if (memcmp(hash3, hash3Check, PUF_SIZE) != 0) {
+            onTimeout(out);
+            return;
+        }
+
+        // A saves the new challenge
+        state = FINISHED;
+        PeerHandle saved = uav.setUAV(peerId, nullptr, NC);
+        if (saved == PEER_NONE) {
+            finish(-1);
+            return;
+        }
+        uav.saveUAV(saved);
+        PROD_ONLY({std::cout << "\nThe two UAV autenticated each other.\n";});
+        finish(0);
+    }
+}
+
+/// @brief Without the ACK, A saves the new challenge and keeps the transmitted one concealed.
+void SupplementaryInitialSession::onTimeout(std::vector<ProtocolMessage> &out) {
+    if (state != AWAIT_HASH3) {
+        ProtocolSession::onTimeout(out);
+        return;
+    }
+
+    unsigned char xLock[PUF_SIZE];
+    generate_random_bytes(xLock);
+
+    unsigned char lock[PUF_SIZE];
+    uav.callPUF(xLock, lock);
+
+    unsigned char concealedCA[PUF_SIZE];
+    xor_buffers(CA, lock, PUF_SIZE, concealedCA);
+
+    uav.saveUAV(uav.setUAV(peerId, nullptr, NC, nullptr, xLock, concealedCA));
+    state = FINISHED;
+    finish(1);
+}
+
+SupplementarySupSession::SupplementarySupSession(UAV &uav) : ProtocolSession(uav, ""), state(START) {}
+
+/// @brief C introduces itself to A.
+void SupplementarySupSession::start(std::vector<ProtocolMessage> &out) {
+    out.push_back(newMessage());
+    state = AWAIT_NA;
+}
+
+void SupplementarySupSession::onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) {
+    // C retrieve the CA of the UAV answering from memory
+    if (!learnPeer(in)) {
+        finish(-1);
+        return;
+    }
+
+    UAVData peer;
+    if (!readPeer(peer) || peer.getC() == nullptr || peer.getXLock() == nullptr || peer.getSecret() == nullptr) {
+        PROD_ONLY({std::cout << "No challenge in memory for the requested UAV.\n";});
+        finish(1);
+        return;
+    }
+
+    if (state == AWAIT_NA) {
+        if (!extractValueFromMap(in, "NA", NA, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+
+        // C recovers RA from the concealed secret
+        const unsigned char * CA = peer.getC();
+        unsigned char lock[PUF_SIZE];
+        uav.callPUF(peer.getXLock(), lock);
+        xor_buffers(lock, peer.getSecret(), PUF_SIZE, RA);
+
+        // C then creates a nonce NC and the secret message M1
+        generate_random_bytes(gammaC);
+        uav.callPUF(gammaC, NC);
+
+        unsigned char M1[PUF_SIZE];
+        xor_buffers(RA, NC, PUF_SIZE, M1);
+
+        unsigned char hash1[PUF_SIZE];
+        TranscriptHash()
+            .add(uav.getId())
+            .add(CA)
+            .add(NC)
+            .add(RA)
+            .add(NA)
+            .finish(hash1);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("CA", std::string(reinterpret_cast<const char*>(CA), PUF_SIZE));
+        msg.emplace("M1", std::string(reinterpret_cast<const char*>(M1), PUF_SIZE));
+        msg.emplace("hash1", std::string(reinterpret_cast<const char*>(hash1), PUF_SIZE));
+        out.push_back(std::move(msg));
+
+        hash2Prefix.reset();
+        hash2Prefix.add(NC).add(RA);
+        state = AWAIT_M2;
+    }
+    else if (state == AWAIT_M2) {
+        unsigned char M2[PUF_SIZE];
+        unsigned char hash2[PUF_SIZE];
+        if (!extractValueFromMap(in, "M2", M2, PUF_SIZE) || !extractValueFromMap(in, "hash2", hash2, PUF_SIZE)) {
+            finish(-1);
+            return;
+        }
+
+        unsigned char RAp[PUF_SIZE];
+        xor_buffers(M2, NC, PUF_SIZE, RAp);
+
+        unsigned char hash2Check[PUF_SIZE];
+        TranscriptHash(hash2Prefix)
+            .add(RAp)
+            .add(NA)
+            .finish(hash2Check);
+
+        state = FINISHED;
+        if (memcmp(hash2, hash2Check, PUF_SIZE) != 0) {
+            PROD_ONLY({std::cout << "The hashes do not correspond.\n";});
+            finish(1);
+            return;
+        }
+
+        // C changes its values
+        uav.commitUAV(peerHandle, nullptr, gammaC, RAp);
+
+        unsigned char hash3[PUF_SIZE];
+        TranscriptHash()
+            .add(RAp)
+            .add(NC)
+            .add(NA)
+            .finish(hash3);
+
+        ProtocolMessage msg = newMessage();
+        msg.emplace("hash3", std::string(reinterpret_cast<const char*>(hash3), PUF_SIZE));
+        out.push_back(std::move(msg));
+        PROD_ONLY({std::cout << "\nThe two UAV autenticated each other.\n";});
+        finish(0);
+    }
+}
+
+// Drivers
+
+std::unique_ptr<ProtocolSession> createResponderSession(UAV &uav, const ProtocolMessage &first) {
+    auto it = first.find("id");
+    if (it == first.end() || it->second.empty()) {
+        return std::unique_ptr<ProtocolSession>();
+    }
+
+    if (first.count("CB")) {
+        return std::unique_ptr<ProtocolSession>(new EnrolmentServerSession(uav));
+    }
+    if (first.count("M0")) {
+        return std::unique_ptr<ProtocolSession>(new AuthenticationServerSession(uav));
+    }
+    if (first.size() == 1) {
+        return std::unique_ptr<ProtocolSession>(new SupplementaryInitialSession(uav));
+    }
+    return std::unique_ptr<ProtocolSession>();
+}
+
+int runSession(ProtocolSession &session, SocketModule &socketModule, const char *name) {
+    (void)name;
+
+    #ifdef MEASUREMENTS_DETAILLED
+        long long start;
+        long long end;
+        long long idlCycles = 0;
+        long long opCycles = 0;
+        CycleCounter counter;
+    #endif
+
+    MEASURE_ONLY({
+        start = counter.getCycles();
+    });
+    TRACE_PHASE(handshake, name);
+
+    std::vector<ProtocolMessage> out;
+    session.start(out);
+
+    while (true) {
+        // Messages emitted together, e.g. RB and CA, leave in one segment
+        bool batch = out.size() > 1;
+        if (batch) socketModule.cork();
+        for (const ProtocolMessage &msg : out) {
+            socketModule.sendMsg(msg);
+        }
+        if (batch) socketModule.uncork();
+        out.clear();
+
+        if (session.isDone()) break;
+
+        MEASURE_ONLY({
+            end = counter.getCycles();
+            opCycles += end - start;
+            start = counter.getCycles();
+        });
+
+        ProtocolMessage in;
+        {
+            TRACE_PHASE(wait, "recv");
+            socketModule.receiveMsg(in);
+        }
+        PROD_ONLY({printMsg(in);});
+        MEASURE_ONLY({
+            end = counter.getCycles();
+            idlCycles += end - start;
+            start = counter.getCycles();
+        });
+
+        if (in.empty()) {
+            session.onTimeout(out);
+        } else {
+            session.onMessage(in, out);
+        }
+    }
+
+    MEASURE_ONLY({
+        end = counter.getCycles();
+        opCycles += end - start;
+        std::cout << "Elapsed CPU cycles " << name << ": " << opCycles + idlCycles << " cycles" << std::endl;
+        std::cout << "operational Elapsed CPU cycles " << name << ": " << opCycles << " cycles" << std::endl;
+        std::cout << "idle Elapsed CPU cycles " << name << ": " << idlCycles << " cycles\n" << std::endl;
+        recordCycles(name, opCycles, idlCycles);
+        counter.printTotals(name);
+    });
+    return session.getResult();
+}
@@ -0,0 +1,182 @@
+/**
+ * @file ProtocolSession.hpp
+ * @brief ProtocolSession classes header
+ *
+ * This file holds the resumable versions of the UAV protocols. Each session object carries one
+ * handshake with one peer : it is fed with the incoming messages and emits the outgoing ones,
+ * so it can be driven by a blocking socket, an event loop, a thread pool or a test harness.
+ *
+ */
+
+#ifndef PROTOCOLSESSION_HPP
+#define PROTOCOLSESSION_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.hpp"
+#include "UAV.hpp"
+#include "TranscriptHash.hpp"
+
+typedef std::unordered_map<std::string, std::string> ProtocolMessage;
+
+/// @brief Base class of every protocol state machine.
+class ProtocolSession {
+protected:
+    UAV &uav;
+    std::string peerId;
+    PeerHandle peerHandle;
+    int result;     // Same codes as the blocking functions : 0 success, 1 failure, -1 error
+    bool done;
+
+    void finish(int result);
+    bool learnPeer(const ProtocolMessage &in);
+    bool readPeer(UAVData &data);
+    bool updatePeer(const std::function<void(UAVData &data)> &change);
+    ProtocolMessage newMessage() const;
+
+public:
+    ProtocolSession(UAV &uav, const std::string &peerId);
+    virtual ~ProtocolSession();
+
+    // Delete copy constructor and copy assignment operator
+    ProtocolSession(const ProtocolSession&) = delete;
+    ProtocolSession& operator=(const ProtocolSession&) = delete;
+
+    virtual void start(std::vector<ProtocolMessage> &out);
+    virtual void onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) = 0;
+    virtual void onTimeout(std::vector<ProtocolMessage> &out);
+
+    bool isDone() const;
+    int getResult() const;
+    const std::string& getPeerId() const;
+};
+
+/// @brief Protocol run by UAV::enrolment_client. The peer id is learnt from the answer carrying RB.
+class EnrolmentClientSession : public ProtocolSession {
+private:
+    enum State { START, AWAIT_RB, AWAIT_CA, FINISHED } state;
+
+    unsigned char xB[PUF_SIZE];
+
+public:
+    explicit EnrolmentClientSession(UAV &uav);
+    void start(std::vector<ProtocolMessage> &out) override;
+    void onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) override;
+};
+
+/// @brief Protocol run by UAV::enrolment_server, or by UAV::enrolment_server_pipelined when pipelined is set.
+/// The peer id is learnt from the first message.
+class EnrolmentServerSession : public ProtocolSession {
+private:
+    enum State { AWAIT_CB, AWAIT_RA, FINISHED } state;
+    bool pipelined;
+
+public:
+    explicit EnrolmentServerSession(UAV &uav, bool pipelined = false);
+    void onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) override;
+};
+
+/// @brief Protocol run by UAV::autentication_client and UAV::autentication_key_client.
+class AuthenticationClientSession : public ProtocolSession {
+private:
+    enum State { START, AWAIT_M1, AWAIT_HASH3, FINISHED } state;
+    bool withKey;
+
+    unsigned char CA[PUF_SIZE];
+    unsigned char NA[PUF_SIZE];
+    unsigned char NB[PUF_SIZE];
+    unsigned char M0[PUF_SIZE];
+    unsigned char RAp[PUF_SIZE];
+    unsigned char K[PUF_SIZE];
+
+    void concealAndRotate();
+
+public:
+    AuthenticationClientSession(UAV &uav, const std::string &peerId, bool withKey = false);
+    void start(std::vector<ProtocolMessage> &out) override;
+    void onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) override;
+    void onTimeout(std::vector<ProtocolMessage> &out) override;
+    const unsigned char* getKey() const;
+};
+
+/// @brief Protocol run by UAV::autentication_server and UAV::autentication_key_server.
+/// The key variant is recognised from the presence of MK in the second message. The peer id is learnt from the first message.
+class AuthenticationServerSession : public ProtocolSession {
+private:
+    enum State { AWAIT_M0, AWAIT_M2, FINISHED } state;
+    bool withKey;
+
+    unsigned char NA[PUF_SIZE];
+    unsigned char NB[PUF_SIZE];
+    unsigned char RA[PUF_SIZE];
+    unsigned char gammaB[PUF_SIZE];
+    unsigned char K[PUF_SIZE];
+    TranscriptHash hash2Prefix;     // NB, RA
+
+public:
+    explicit AuthenticationServerSession(UAV &uav);
+    void onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) override;
+    bool hasKey() const;
+    const unsigned char* getKey() const;
+};
+
+/// @brief Protocol run by UAV::supplementaryAuthenticationInitial. The peer id is learnt from the first message.
+class SupplementaryInitialSession : public ProtocolSession {
+private:
+    enum State { AWAIT_ID, AWAIT_M1, AWAIT_HASH3, FINISHED } state;
+
+    unsigned char CA[PUF_SIZE];
+    unsigned char NA[PUF_SIZE];
+    unsigned char NC[PUF_SIZE];
+    unsigned char RAp[PUF_SIZE];
+
+public:
+    explicit SupplementaryInitialSession(UAV &uav);
+    void onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) override;
+    void onTimeout(std::vector<ProtocolMessage> &out) override;
+};
+
+/// @brief Protocol run by UAV::supplementaryAuthenticationSup. The peer id is learnt from the answer carrying NA.
+class SupplementarySupSession : public ProtocolSession {
+private:
+    enum State { START, AWAIT_NA, AWAIT_M2, FINISHED } state;
+
+    unsigned char NA[PUF_SIZE];
+    unsigned char NC[PUF_SIZE];
+    unsigned char RA[PUF_SIZE];
+    unsigned char gammaC[PUF_SIZE];
+    TranscriptHash hash2Prefix;     // NC, RA
+
+public:
+    explicit SupplementarySupSession(UAV &uav);
+    void start(std::vector<ProtocolMessage> &out) override;
+    void onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) override;
+};
+
+/**
+ * @brief Create the responder session matching the first message sent by a peer :
+ * CB starts an enrolment, M0 an authentication and a bare id a supplementary authentication.
+ *
+ * @param uav
+ * @param first
+ * @return The session, or nullptr if the message does not open any known protocol
+ */
+std::unique_ptr<ProtocolSession> createResponderSession(UAV &uav, const ProtocolMessage &first);
+
+/**
+ * @brief Drive a session to completion over a blocking SocketModule. This is how the blocking functions of UAV
+ * run the protocols : the messages emitted together leave in one segment, and the measurements and the trace
+ * of the handshake are taken here, the waits for the peer counting as idle cycles.
+ *
+ * @param session
+ * @param socketModule
+ * @param name Name of the handshake in the measurements and the trace, e.g. "authentication.client"
+ * @return The session result
+ */
+int runSession(ProtocolSession &session, SocketModule &socketModule, const char *name = "session");
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * @file SessionMux.cpp
+ * @brief SessionMux class implementation
+ *
+ * This file holds the SessionMux class implementation.
+ *
+ */
+
+#include "SessionMux.hpp"
+
+/// @brief Constructor
+/// @param responder UAV answering the sessions opened by the peer, nullptr to only open sessions
+SessionMux::SessionMux(UAV *responder) : responder(responder), nextSid(0), failures(0) {}
+
+/// @brief Set the handler called with every session once it is done, before it is deleted
+void SessionMux::onDone(DoneHandler handler) { doneHandler = handler; }
+
+/// @brief Tag the messages of a session with its id and append them to the output.
+/// @param sid Id of the session as this side sends it, with its role in the session
+/// @param replies
+/// @param out
+void SessionMux::emit(const std::string &sid, std::vector<ProtocolMessage> &replies, std::vector<ProtocolMessage> &out) {
+    for (ProtocolMessage &msg : replies) {
+        msg.emplace(MUX_SESSION_KEY, sid);
+        out.push_back(std::move(msg));
+    }
+    replies.clear();
+}
+
+/// @brief Report a session if it is done, then forget it.
+/// @param sid
+void SessionMux::reap(const std::string &sid) {
+    auto it = sessions.find(sid);
+    if (it == sessions.end() || !it->second->isDone()) return;
+
+    if (it->second->getResult() != 0) failures++;
+    if (doneHandler) doneHandler(sid, *it->second);
+    sessions.erase(it);
+}
+
+/**
+ * @brief Start a session opened by this side.
+ *
+ * @param session An initiator session, e.g. an EnrolmentClientSession
+ * @param out Receives its first messages, tagged
+ * @return The id of the session
+ */
+std::string SessionMux::open(std::unique_ptr<ProtocolSession> session, std::vector<ProtocolMessage> &out) {
+    std::string sid = MUX_INITIATOR + std::to_string(nextSid++);
+    std::vector<ProtocolMessage> replies;
+    session->start(replies);
+    sessions[sid] = std::move(session);
+
+    emit(sid, replies, out);
+    reap(sid);
+    return sid;
+}
+
+/**
+ * @brief Hand a message to its session. A new id from the peer creates the responder session it opens.
+ *
+ * @param in
+ * @param out Receives the answers, tagged
+ * @return false if the message has no valid session id, answers no session of this side, or opens no known protocol
+ */
+bool SessionMux::onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out) {
+    auto tag = in.find(MUX_SESSION_KEY);
+    if (tag == in.end()) {
+        return false;
+    }
+    const std::string &wireSid = tag->second;
+    if (wireSid.size() < 2 || (wireSid[0] != MUX_INITIATOR && wireSid[0] != MUX_RESPONDER)) {
+        std::cerr << "Error: invalid session id " << wireSid << std::endl;
+        return false;
+    }
+
+    // The peer sends its own role in the session, this side keeps the session under its role
+    bool peerOpened = (wireSid[0] == MUX_INITIATOR);
+    const std::string sid = (peerOpened ? MUX_RESPONDER : MUX_INITIATOR) + wireSid.substr(1);
+
+    // The sessions see the messages as they would without the mux
+    ProtocolMessage msg(in);
+    msg.erase(MUX_SESSION_KEY);
+
+    auto it = sessions.find(sid);
+    if (it == sessions.end()) {
+        std::unique_ptr<ProtocolSession> session;
+        if (peerOpened && responder != nullptr) {
+            session = createResponderSession(*responder, msg);
+        }
+        if (!session) {
+            std::cerr << "Error: unexpected message for session " << sid << std::endl;
+            return false;
+        }
+        it = sessions.emplace(sid, std::move(session)).first;
+    }
+
+    std::vector<ProtocolMessage> replies;
+    it->second->onMessage(msg, replies);
+    emit(sid, replies, out);
+    reap(sid);
+    return true;
+}
+
+/// @brief The peer did not answer in time : every open session handles the timeout.
+/// @param out Receives the messages some sessions send again, tagged
+void SessionMux::onTimeout(std::vector<ProtocolMessage> &out) {
+    std::vector<std::string> open;
+    open.reserve(sessions.size());
+    for (const auto &it : sessions) {
+        open.push_back(it.first);
+    }
+
+    std::vector<ProtocolMessage> replies;
+    for (const std::string &sid : open) {
+        sessions[sid]->onTimeout(replies);
+        emit(sid, replies, out);
+        reap(sid);
+    }
+}
+
+/// @brief Get the number of sessions still running
+size_t SessionMux::openCount() const {
+    return sessions.size();
+}
+
+/// @brief Get the number of sessions that ended with another result than 0
+size_t SessionMux::getFailures() const {
+    return failures;
+}
+
+/// @brief Check whether a message belongs to a multiplexed session
+bool SessionMux::isMuxed(const ProtocolMessage &msg) {
+    return msg.find(MUX_SESSION_KEY) != msg.end();
+}
+
+int runMux(SessionMux &mux, SocketModule &socketModule, std::vector<ProtocolMessage> &out) {
+    size_t failures = mux.getFailures();
+
+    while (true) {
+        socketModule.cork();
+        for (const ProtocolMessage &msg : out) {
+            socketModule.sendMsg(msg);
+        }
+        socketModule.uncork();
+        out.clear();
+
+        if (mux.openCount() == 0) break;
+
+        ProtocolMessage in;
+        socketModule.receiveMsg(in);
+        if (in.empty()) {
+            mux.onTimeout(out);
+        } else if (!mux.onMessage(in, out)) {
+            return 1;
+        }
+    }
+    return mux.getFailures() == failures ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file SessionMux.hpp
+ * @brief SessionMux class header
+ *
+ * This file holds the SessionMux class header.
+ *
+ */
+
+#ifndef SESSIONMUX_HPP
+#define SESSIONMUX_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ProtocolSession.hpp"
+
+#define MUX_SESSION_KEY "sid"
+#define MUX_INITIATOR 'i'
+#define MUX_RESPONDER 'r'
+
+/// @brief Many protocol sessions over one connection. Every message carries the id of its session under the
+/// "sid" key : the side opening a session picks the number, the other side creates the matching responder
+/// session the first time it sees it. Both sides number their sessions from 0, so the id starts with the role
+/// of the sender in the session, 'i' for the one that opened it and 'r' for the responder : "i0" and "r0" are
+/// two different sessions, each side keeping them apart when it both opens sessions and answers the peer's.
+/// A relay can so enrol or authenticate its whole sub-swarm with the ground station over a single connection,
+/// instead of one connection per drone.
+class SessionMux {
+public:
+    typedef std::function<void(const std::string &sid, ProtocolSession &session)> DoneHandler;
+
+private:
+    UAV *responder;     // Serves the sessions opened by the peer, nullptr if this side only opens sessions
+    std::unordered_map<std::string, std::unique_ptr<ProtocolSession>> sessions;    // Keyed by the id this side sends
+    unsigned long nextSid;
+    size_t failures;
+    DoneHandler doneHandler;
+
+    void emit(const std::string &sid, std::vector<ProtocolMessage> &replies, std::vector<ProtocolMessage> &out);
+    void reap(const std::string &sid);
+
+public:
+    explicit SessionMux(UAV *responder = nullptr);
+
+    // Delete copy constructor and copy assignment operator
+    SessionMux(const SessionMux&) = delete;
+    SessionMux& operator=(const SessionMux&) = delete;
+
+    void onDone(DoneHandler handler);
+
+    std::string open(std::unique_ptr<ProtocolSession> session, std::vector<ProtocolMessage> &out);
+    bool onMessage(const ProtocolMessage &in, std::vector<ProtocolMessage> &out);
+    void onTimeout(std::vector<ProtocolMessage> &out);
+
+    size_t openCount() const;
+    size_t getFailures() const;
+
+    static bool isMuxed(const ProtocolMessage &msg);
+};
+
+/**
+ * @brief Drive every session of a mux to completion over a blocking SocketModule. The messages of all the
+ * sessions that are ready leave together, in one send.
+ *
+ * @param mux
+ * @param socketModule
+ * @param out The first messages of the sessions, as filled by SessionMux::open
+ * @return 0 if every session succeeded, 1 otherwise
+ */
+int runMux(SessionMux &mux, SocketModule &socketModule, std::vector<ProtocolMessage> &out);
+
+#endif
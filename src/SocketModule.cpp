@@ -7,45 +7,48 @@
  */
 
 #include "SocketModule.hpp"
+#include "drbg.hpp"
 
 /// @brief Constructor: Initializes socket
-SocketModule::SocketModule() : socket_fd(-1), connection_fd(-1) {}
+SocketModule::SocketModule() : socket_fd(-1), preferBinary(false), binaryWire(false), viewedFrame(0), corked(false) {}
 
 /// @brief Initiates a client connection
 bool SocketModule::initiateConnection(const std::string& ip, int port) {
     
     // Create a socket
-    socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (socket_fd == -1) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
         perror("Socket creation failed");
         return false;
     }
 
     int opt = 1;
-    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
 
     struct timeval timeout;      
     timeout.tv_sec = TIMEOUT_VALUE;  // Timeout after 5 seconds
     timeout.tv_usec = 0; 
 
     // Set the timeout
-    setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
 
     address.sin_family = AF_INET;
     address.sin_port = htons(port);
     
     if (inet_pton(AF_INET, ip.c_str(), &address.sin_addr) <= 0) {
         perror("Invalid address");
+        close(fd);
         return false;
     }
 
     // Connect to the server
-    if (connect(socket_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
         perror("Connection failed");
+        close(fd);
         return false;
     }
 
-    connection_fd = socket_fd;
+    useTransport(std::unique_ptr<Transport>(new TcpTransport(fd)));
     return true;
 }
 
@@ -88,7 +91,7 @@ bool SocketModule::waitForConnection(int port) {
     // std::cout << "Waiting for a connection on port " << port << "...\n";
 
     socklen_t addr_len = sizeof(address);
-    connection_fd = accept(socket_fd, (struct sockaddr*)&address, &addr_len);
+    int connection_fd = accept(socket_fd, (struct sockaddr*)&address, &addr_len);
     if (connection_fd < 0) {
         perror("Accept failed");
         return false;
@@ -99,101 +102,267 @@ bool SocketModule::waitForConnection(int port) {
     // Set the timeout
     setsockopt(connection_fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
     setsockopt(connection_fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    useTransport(std::unique_ptr<Transport>(new TcpTransport(connection_fd)));
     return true;
 }
 
-/// @brief Send a msgPack message over the socket
+/// @brief Use an already connected transport, e.g. one end of a LoopbackTransport pair, as the connection.
+/// @param transport
+void SocketModule::useTransport(std::unique_ptr<Transport> transport) {
+    this->transport = std::move(transport);
+    binaryWire = preferBinary;
+    out.clear();
+    corked = false;
+}
+
+/// @brief Send a msgPack message over the socket. Between cork() and uncork(), the message is only queued.
 /// @param msgPack The message to send
 void SocketModule::sendMsg(const std::unordered_map<std::string, std::string> &msgPack) {
-    // Serialize the map using msgpack
     if(this->isOpen() == false) {
         std::cerr << "Error: Connection is not open!" << std::endl;
         return;
     }
-    msgpack::sbuffer sbuf;
-    msgpack::pack(sbuf, msgPack);
-    send(this->connection_fd, sbuf.data(), sbuf.size(), 0);
+
+    // On a binary connection, known messages travel as fixed frames
+    wireAppend(out, msgPack, binaryWire);
+    if (!corked) {
+        flushOut();
+    }
+}
+
+/// @brief Send the queued messages in one send(). The buffer keeps its capacity for the next messages.
+/// @return false if the connection failed
+bool SocketModule::flushOut() {
+    if (out.empty()) {
+        return true;
+    }
+    bool sent = isOpen() && transport->send(out.data(), out.size()) == static_cast<ssize_t>(out.size());
+    if (!sent) {
+        perror("Send failed");
+    }
+    out.clear();
+    return sent;
+}
+
+/// @brief Hold the next messages until uncork(), so that back-to-back messages, e.g. RB and CA during the
+/// enrolment, cost one syscall and one TCP segment instead of one each.
+void SocketModule::cork() {
+    corked = true;
+}
+
+/// @brief Send every message held since cork() at once.
+/// @return false if the connection failed
+bool SocketModule::uncork() {
+    corked = false;
+    return flushOut();
+}
+
+/**
+ * @brief Read once from the connection, straight into the unpacker buffer.
+ * 
+ * @return false on timeout, closed connection or error
+ */
+bool SocketModule::readMore(){
+    if (!isOpen()) {
+        std::cerr << "Error: Connection is not open!" << std::endl;
+        return false;
+    }
+    pac.reserve_buffer(1024);
+
+    // Never wait for an answer to a message still held
+    if (!out.empty()) {
+        corked = false;
+        flushOut();
+    }
+
+    // The next nonces are generated while the peer is still working
+    drbg_fill(DRBG_PREFILL_SIZE);
+
+    ssize_t bytesReceived = transport->receive(pac.buffer(), pac.buffer_capacity());
+    if (bytesReceived > 0) { 
+        PROD_ONLY({std::cout << "Received " << bytesReceived << "bytes." << std::endl;});
+        pac.buffer_consumed(bytesReceived);
+        return true;
+    } 
+    else if (bytesReceived == 0) {
+        std::cerr << "Connection closed by peer." << std::endl;
+        return false;
+    } 
+    else {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            std::cerr << "Receive timeout!" << std::endl;
+        } else {
+            perror("Receive failed");
+        }
+        return false;
+    }
+}
+
+/// @brief Drop the frame handed out by the last receiveView, the view is not valid anymore.
+void SocketModule::releaseView(){
+    if (viewedFrame > 0) {
+        pac.skip_nonparsed_buffer(viewedFrame);
+        viewedFrame = 0;
+    }
 }
 
 /**
  * @brief Receive a message on the msgPack format and return it in the unordered_map msg.  
+ * Binary frames are accepted as well, and switch the connection to binary frames.
  * 
  * @param msg 
  */
 void SocketModule::receiveMsg(std::unordered_map<std::string, std::string> &msg){
-    char buffer[1024] = {0};
     msgpack::object_handle msgpack_obj;
+    WireFrame frame;
+
+    releaseView();
+    while(true)
+    {
+        WireParse parsed = wireParseNext(pac, msgpack_obj, frame);
+
+        if (parsed == WIRE_PARSE_MSGPACK) { // There is a complete parsed message in the unpacker 'pac'
+            msgpack::object obj = msgpack_obj.get();    // Get the object
 
-    if (pac.next(msgpack_obj)) { // This is true only if there is a complete parsed message in the unpacker 'pac'
-        msgpack::object obj = msgpack_obj.get();
+            for (uint32_t i = 0; i < obj.via.map.size; ++i) {       // For all key-value in the map 
+                const msgpack::object_kv& kv = obj.via.map.ptr[i];  // Get the kv object
 
-        if (obj.type != msgpack::type::MAP) {
+                std::string key;
+                std::string value;
+
+                kv.key.convert(key);        // Extract the key    
+                kv.val.convert(value);      // Extract the value
+
+                msg.emplace(std::move(key), std::move(value));  // Insert directly with emplace
+            }
+            return;
+        }
+        if (parsed == WIRE_PARSE_FRAME) {
+            binaryWire = true;  // The peer speaks binary frames, answer the same way
+            wireToMap(frame, msg);
+            return;
+        }
+        if (parsed == WIRE_PARSE_INVALID) {
             throw std::runtime_error("Expected a map");
         }
 
-        for (uint32_t i = 0; i < obj.via.map.size; ++i) {
-            const msgpack::object_kv& kv = obj.via.map.ptr[i];
+        if (!readMore()) {
+            return;
+        }
+    }
+}
 
-            std::string key;
-            std::string value;
+/// @brief Choose whether the next connections open with binary frames instead of msgPack maps.
+/// A peer answering with frames is also switched to frames automatically.
+/// @param enable
+void SocketModule::useBinaryWire(bool enable) {
+    preferBinary = enable;
+    if (isOpen()) binaryWire = enable;
+}
 
-            kv.key.convert(key);    
-            kv.val.convert(value);   
+/// @brief Check whether the current connection uses binary frames
+bool SocketModule::isBinaryWire() const {
+    return binaryWire;
+}
 
-            msg.emplace(std::move(key), std::move(value));  // Insert directly
-        }
+/// @brief Send a binary frame over the socket. Between cork() and uncork(), the frame is only queued.
+/// @param frame
+void SocketModule::sendFrame(const WireFrame &frame) {
+    if(this->isOpen() == false) {
+        std::cerr << "Error: Connection is not open!" << std::endl;
         return;
     }
+    out.append(reinterpret_cast<const char*>(&frame), wireSize(frame));
+    if (!corked) {
+        flushOut();
+    }
+}
+
+/**
+ * @brief Receive the next message as a binary frame. A msgPack message is converted if it has a binary layout.
+ * 
+ * @param frame 
+ * @return false on timeout, closed connection or unknown message
+ */
+bool SocketModule::receiveFrame(WireFrame &frame){
+    msgpack::object_handle msgpack_obj;
+
+    releaseView();
     while(true)
     {
-        int bytesReceived = read(this->connection_fd, buffer, sizeof(buffer));
-        if (bytesReceived > 0) { 
-            PROD_ONLY({std::cout << "Received " << bytesReceived << "bytes." << std::endl;});
-            pac.reserve_buffer(bytesReceived);
-            std::memcpy(pac.buffer(), buffer, bytesReceived);
-            pac.buffer_consumed(bytesReceived);
+        WireParse parsed = wireParseNext(pac, msgpack_obj, frame);
 
-            if (pac.next(msgpack_obj)) { // Check whether there is a complete message
-                msgpack::object obj = msgpack_obj.get();    // Get the object
+        if (parsed == WIRE_PARSE_FRAME) {
+            binaryWire = true;
+            return true;
+        }
+        if (parsed == WIRE_PARSE_MSGPACK) {
+            msgpack::object obj = msgpack_obj.get();
+            std::unordered_map<std::string, std::string> msg;
+            for (uint32_t i = 0; i < obj.via.map.size; ++i) {
+                const msgpack::object_kv& kv = obj.via.map.ptr[i];
+                msg.emplace(kv.key.as<std::string>(), kv.val.as<std::string>());
+            }
+            return wireFromMap(msg, frame);
+        }
+        if (parsed == WIRE_PARSE_INVALID) {
+            throw std::runtime_error("Expected a map");
+        }
 
-                if (obj.type != msgpack::type::MAP) {       // Verify that it's a map
-                    throw std::runtime_error("Expected a map");
-                }
+        if (!readMore()) {
+            return false;
+        }
+    }
+}
 
-                for (uint32_t i = 0; i < obj.via.map.size; ++i) {       // For all key-value in the map 
-                    const msgpack::object_kv& kv = obj.via.map.ptr[i];  // Get the kv object
+/**
+ * @brief Receive a message without copying it : the view points into the receive buffer and
+ * stays valid until the next receive on this socket. The view is left empty on timeout or error.
+ * 
+ * @param view 
+ */
+void SocketModule::receiveView(MsgView &view){
+    releaseView();
+    view.clear();
 
-                    std::string key;
-                    std::string value;
+    while(true)
+    {
+        size_t frameSize = 0;
+        WireParse parsed = wirePeekNext(pac, view.handle, view.frame, frameSize);
 
-                    kv.key.convert(key);        // Extract the key    
-                    kv.val.convert(value);      // Extract the value
+        if (parsed == WIRE_PARSE_MSGPACK) {
+            view.kind = MsgView::MSGPACK;
+            return;
+        }
+        if (parsed == WIRE_PARSE_FRAME) {
+            binaryWire = true;
+            viewedFrame = frameSize;    // Consumed by the next receive
+            view.kind = MsgView::FRAME;
+            return;
+        }
+        if (parsed == WIRE_PARSE_INVALID) {
+            throw std::runtime_error("Expected a map");
+        }
 
-                    msg.emplace(std::move(key), std::move(value));  // Insert directly with emplace
-                }
-                return;
-            }
-        } 
-        else if (bytesReceived == 0) {
-            std::cerr << "Connection closed by peer." << std::endl;
+        if (!readMore()) {
+            view.clear();
             return;
-        } 
-        else {
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                std::cerr << "Receive timeout!" << std::endl;
-                return;
-           } else {
-                perror("Receive failed");
-                return;
-            }
         }
     }
 }
 
 /// @brief Close the connection
 void SocketModule::closeConnection() {
-    if (connection_fd != -1) close(connection_fd);
-    if (socket_fd != -1) close(socket_fd);
+    corked = false;
+    flushOut();
+    if (transport) {
+        transport->close();
+        transport.reset();
+    }
+    if (socket_fd != -1) {
+        close(socket_fd);
+        socket_fd = -1;
+    }
 }
 
 /// @brief Destructor ensures the connection is closed
@@ -203,15 +372,15 @@ SocketModule::~SocketModule() {
 
 /// @brief Check if the socket is open
 bool SocketModule::isOpen() const {
-    return (socket_fd != -1 && connection_fd != -1);
+    return transport && transport->isOpen();
 }
 
-/// @brief Get the socket file descriptor
+/// @brief Get the listening socket file descriptor
 int SocketModule::getSocketFd() const {
     return socket_fd;
 }
 
 /// @brief Get the connection file descriptor
 int SocketModule::getConnectionFd() const {
-    return connection_fd;
+    return transport ? transport->getFd() : -1;
 }
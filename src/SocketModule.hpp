@@ -11,21 +11,35 @@
 
 #include <iostream>
 #include <cstring>
+#include <memory>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <msgpack.hpp>
 
 #include "utils.hpp"
+#include "WireFormat.hpp"
+#include "MsgView.hpp"
+#include "Transport.hpp"
 
 #define TIMEOUT_VALUE  5
 
 /// @brief Socket module class. Its job is to manage everything connection related for a server and a client.
+/// The messages go through a Transport : a TCP connection opened by the module, or any transport given to useTransport().
 class SocketModule {
 private:
-    int socket_fd;         // Socket file descriptor
-    int connection_fd;     // Used when acting as a server
+    int socket_fd;         // Listening socket, used when acting as a server
+    std::unique_ptr<Transport> transport;   // Current connection
     struct sockaddr_in address;
     msgpack::unpacker pac;
+    bool preferBinary;     // Open connections with binary frames
+    bool binaryWire;       // Binary frames are used on the current connection
+    size_t viewedFrame;    // Size of the frame still referenced by the last MsgView
+    std::string out;       // Messages not sent yet, the buffer is reused from send to send
+    bool corked;           // Hold the messages until uncork()
+
+    bool readMore();
+    void releaseView();
+    bool flushOut();
 
 public:
     SocketModule();  // Constructor
@@ -43,10 +57,19 @@ public:
 
     bool initiateConnection(const std::string& ip, int port);
     bool waitForConnection(int port);
+    void useTransport(std::unique_ptr<Transport> transport);
     
     void sendMsg(const std::unordered_map<std::string, std::string> &msg);
     void receiveMsg(std::unordered_map<std::string, std::string> &msg);
 
+    void useBinaryWire(bool enable);
+    bool isBinaryWire() const;
+    void sendFrame(const WireFrame &frame);
+    void cork();
+    bool uncork();
+    bool receiveFrame(WireFrame &frame);
+    void receiveView(MsgView &view);
+
     void closeConnection();
     bool isOpen() const;
     int getSocketFd() const;
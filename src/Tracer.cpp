@@ -0,0 +1,206 @@
+/**
+ * @file Tracer.cpp
+ * @brief Tracer class implementation
+ *
+ * This file holds the Tracer class implementation.
+ *
+ */
+
+#include "Tracer.hpp"
+
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+/// @brief Buffers of every thread that recorded an event. They outlive their thread so they can be dumped
+/// after the threads are joined, and the buffers of the ended threads are handed to the new ones.
+struct TraceRegistry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer *> idle;    // Buffers whose thread ended
+};
+
+static TraceRegistry &registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+static long long monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+/// @brief Write a string as a JSON string
+static void writeJsonString(std::ostream &out, const std::string &text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out << c;
+    }
+    out << '"';
+}
+
+TraceBuffer::TraceBuffer() : head(0), tid(0) {}
+
+/// @brief Buffer held by a thread, given back to the registry when the thread ends
+struct TraceBufferOwner {
+    TraceBuffer *buffer;
+
+    TraceBufferOwner() : buffer(nullptr) {}
+    ~TraceBufferOwner() {
+        if (buffer == nullptr) return;
+        TraceRegistry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        reg.idle.push_back(buffer);
+    }
+};
+
+/// @brief Buffer of the calling thread, the one of an ended thread if any, else created and registered,
+/// the first time the thread records
+TraceBuffer &Tracer::threadBuffer() {
+    static thread_local TraceBufferOwner owner;
+    if (owner.buffer == nullptr) {
+        TraceRegistry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        if (!reg.idle.empty()) {
+            owner.buffer = reg.idle.back();
+            reg.idle.pop_back();
+        } else {
+            std::unique_ptr<TraceBuffer> created(new TraceBuffer());
+            created->tid = static_cast<int>(reg.buffers.size()) + 1;
+            owner.buffer = created.get();
+            reg.buffers.push_back(std::move(created));
+        }
+    }
+    return *owner.buffer;
+}
+
+/**
+ * @brief Record the beginning of a span on the calling thread.
+ *
+ * @param name String literal, e.g. "auth.server.recv_M0"
+ */
+void Tracer::begin(const char *name) {
+    TraceBuffer &buffer = threadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    TraceEvent &event = buffer.events[head % TRACE_BUFFER_EVENTS];
+    event.name = name;
+    event.ns = monotonicNs();
+    event.phase = 'B';
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Record the end of the last span begun on the calling thread.
+ *
+ * @param name Same name as the beginning
+ */
+void Tracer::end(const char *name) {
+    TraceBuffer &buffer = threadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    TraceEvent &event = buffer.events[head % TRACE_BUFFER_EVENTS];
+    event.name = name;
+    event.ns = monotonicNs();
+    event.phase = 'E';
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+/// @brief Name of the calling thread in the trace, e.g. the UAV it runs
+void Tracer::setThreadName(const std::string &name) {
+    TraceBuffer &buffer = threadBuffer();
+    std::lock_guard<std::mutex> guard(registry().lock);
+    buffer.threadName = name;
+}
+
+/**
+ * @brief Write the events of every thread as Chrome trace_event JSON. Ends whose beginning was overwritten
+ * in the ring are left out so the spans stay paired.
+ *
+ * @param path
+ * @return 0 if success, 1 if the file cannot be written
+ */
+int Tracer::writeChromeTrace(const std::string &path) {
+    std::ofstream out(path.c_str());
+    if (!out) {
+        std::cerr << "Error: cannot write the trace to " << path << std::endl;
+        return 1;
+    }
+
+    TraceRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+
+    // Times start at the oldest event kept
+    long long origin = -1;
+    for (const std::unique_ptr<TraceBuffer> &buffer : reg.buffers) {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        if (first < head) {
+            long long ns = buffer->events[first % TRACE_BUFFER_EVENTS].ns;
+            if (origin < 0 || ns < origin) origin = ns;
+        }
+    }
+
+    int pid = static_cast<int>(getpid());
+    const char *separator = "\n";
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::fixed << std::setprecision(3);
+    for (const std::unique_ptr<TraceBuffer> &buffer : reg.buffers) {
+        if (!buffer->threadName.empty()) {
+            out << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << buffer->tid
+                << ", \"args\": {\"name\": ";
+            writeJsonString(out, buffer->threadName);
+            out << "}}";
+            separator = ",\n";
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        int depth = 0;
+        for (uint64_t i = first; i < head; i++) {
+            const TraceEvent &event = buffer->events[i % TRACE_BUFFER_EVENTS];
+            if (event.phase == 'E') {
+                if (depth == 0) continue;
+                depth--;
+            } else {
+                depth++;
+            }
+            out << separator << "{\"name\": \"" << event.name << "\", \"cat\": \"sparks\", \"ph\": \"" << event.phase
+                << "\", \"ts\": " << (event.ns - origin) / 1000.0 << ", \"pid\": " << pid << ", \"tid\": " << buffer->tid << "}";
+            separator = ",\n";
+        }
+    }
+    out << "\n]}" << std::endl;
+    return out ? 0 : 1;
+}
+
+/// @brief Forget the recorded events, e.g. after the warmup. The threads must not be recording.
+void Tracer::clear() {
+    TraceRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    for (std::unique_ptr<TraceBuffer> &buffer : reg.buffers) {
+        buffer->head.store(0, std::memory_order_release);
+    }
+}
+
+/// @brief Constructor, begins the span
+TracePhase::TracePhase(const char *name) : name(name) {
+    Tracer::begin(name);
+}
+
+/// @brief Destructor, ends the span
+TracePhase::~TracePhase() {
+    Tracer::end(name);
+}
+
+/// @brief End the current span and begin the next one
+void TracePhase::next(const char *nextName) {
+    Tracer::end(name);
+    name = nextName;
+    Tracer::begin(name);
+}
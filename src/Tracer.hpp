@@ -0,0 +1,92 @@
+/**
+ * @file Tracer.hpp
+ * @brief Tracer class header
+ *
+ * This file holds the Tracer class header.
+ *
+ */
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Events kept per thread, the oldest ones are overwritten. 4096 events take 96 KiB, about 200 handshakes ;
+// build with TRACE_EVENTS=<n> to keep more.
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS 4096
+#endif
+
+//// MACRO
+
+#if defined(TRACING)
+
+    // Tracing: record the phases
+    #define TRACE_PHASE(var, name) TracePhase var(name)
+    #define TRACE_NEXT(var, name)  var.next(name)
+    #define TRACE_ONLY(code)       do { code } while (0)
+
+#else
+
+    // No tracing: the phases cost nothing
+    #define TRACE_PHASE(var, name) do {} while (0)
+    #define TRACE_NEXT(var, name)  do {} while (0)
+    #define TRACE_ONLY(code)       do {} while (0)
+
+#endif
+
+/// @brief One begin or end of a span. The name must be a string literal, only the pointer is kept.
+struct TraceEvent {
+    const char *name;
+    long long ns;       // Monotonic clock
+    char phase;         // 'B' or 'E', as in the Chrome trace_event format
+};
+
+/// @brief Events of one thread. Only the owning thread writes; head is published after each event, so
+/// the buffer can be dumped without stopping the thread, at worst losing the events being overwritten.
+/// When the thread ends, the next thread to record takes the buffer over, with its tid and its events.
+struct TraceBuffer {
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+    std::atomic<uint64_t> head;     // Number of events ever written
+    int tid;
+    std::string threadName;
+
+    TraceBuffer();
+};
+
+/// @brief Records spans into a ring buffer per thread and dumps them as Chrome trace_event JSON,
+/// to be opened in chrome://tracing or Perfetto. Recording takes no lock ; a thread only takes the
+/// registry lock the first time it records and when it ends. There are as many buffers as threads
+/// recording at the same time, so a thread per drone does not keep a buffer per drone ever started.
+class Tracer {
+    private:
+        static TraceBuffer &threadBuffer();
+
+    public:
+        static void begin(const char *name);
+        static void end(const char *name);
+        static void setThreadName(const std::string &name);
+        static int writeChromeTrace(const std::string &path);
+        static void clear();
+};
+
+/// @brief Span of a phase, ended when the object goes out of scope, e.g. on an early return.
+/// next() ends the phase and begins the following one, to follow the steps of a handshake.
+class TracePhase {
+    private:
+        const char *name;
+
+    public:
+        explicit TracePhase(const char *name);
+        ~TracePhase();
+
+        // Delete copy constructor and copy assignment operator
+        TracePhase(const TracePhase&) = delete;
+        TracePhase& operator=(const TracePhase&) = delete;
+
+        void next(const char *nextName);
+};
+
+#endif
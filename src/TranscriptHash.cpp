@@ -0,0 +1,60 @@
+/**
+ * @file TranscriptHash.cpp
+ * @brief TranscriptHash class implementation
+ *
+ * This file holds the TranscriptHash class implementation.
+ *
+ */
+
+#include "TranscriptHash.hpp"
+#include "sha256.hpp"
+
+/**
+ * @brief Construct a new empty TranscriptHash.
+ *
+ */
+TranscriptHash::TranscriptHash() {
+    sha256_accel_init(&this->md);
+}
+
+/**
+ * @brief Drop every field added so far.
+ *
+ */
+void TranscriptHash::reset() {
+    sha256_accel_init(&this->md);
+}
+
+/**
+ * @brief Add a field to the hash.
+ *
+ * @param data
+ * @param size PUF_SIZE by default
+ * @return TranscriptHash&
+ */
+TranscriptHash& TranscriptHash::add(const unsigned char *data, size_t size) {
+    sha256_accel_process(&this->md, data, size);
+    return *this;
+}
+
+/**
+ * @brief Add a string, e.g. an id, to the hash.
+ *
+ * @param str
+ * @return TranscriptHash&
+ */
+TranscriptHash& TranscriptHash::add(const std::string &str) {
+    sha256_accel_process(&this->md, reinterpret_cast<const unsigned char*>(str.data()), str.size());
+    return *this;
+}
+
+/**
+ * @brief Write the hash of every field added so far. The state is left untouched,
+ * so more fields can still be added or the object reused as a prefix.
+ *
+ * @param output PUF_SIZE bytes
+ */
+void TranscriptHash::finish(unsigned char *output) const {
+    hash_state done = this->md;
+    sha256_accel_done(&done, output);
+}
@@ -0,0 +1,34 @@
+/**
+ * @file TranscriptHash.hpp
+ * @brief TranscriptHash class header
+ *
+ * This file holds the TranscriptHash class header. A TranscriptHash is the SHA-256 of the protocol
+ * fields hashed in each message. It lives on the stack : hashing never allocates.
+ * Copying a TranscriptHash clones its state, so a prefix shared by several hashes is only computed once.
+ *
+ */
+
+#ifndef TRANSCRIPTHASH_HPP
+#define TRANSCRIPTHASH_HPP
+
+#include <string>
+
+#include "utils.hpp"
+
+/// @brief Incremental SHA-256 over the protocol fields, e.g. TranscriptHash().add(NB).add(RA).finish(hash)
+class TranscriptHash {
+private:
+    hash_state md;
+
+public:
+    TranscriptHash();
+
+    void reset();
+
+    TranscriptHash& add(const unsigned char *data, size_t size = PUF_SIZE);
+    TranscriptHash& add(const std::string &str);
+
+    void finish(unsigned char *output) const;
+};
+
+#endif
@@ -0,0 +1,177 @@
+/**
+ * @file Transport.cpp
+ * @brief Transport classes implementation
+ *
+ * This file holds the Transport classes implementation.
+ *
+ */
+
+#include "Transport.hpp"
+#include "SocketModule.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+Transport::~Transport() {}
+
+/// @brief File descriptor behind the transport, -1 if there is none
+int Transport::getFd() const {
+    return -1;
+}
+
+/// @brief Constructor, the transport takes the socket over
+TcpTransport::TcpTransport(int fd) : fd(fd) {}
+
+TcpTransport::~TcpTransport() {
+    close();
+}
+
+/**
+ * @brief Send a whole buffer, retrying on short writes. On a non-blocking socket, or one with a send timeout,
+ * a full kernel buffer is waited for up to TIMEOUT_VALUE seconds.
+ *
+ * @param data
+ * @param size
+ * @return The number of bytes sent, -1 on failure
+ */
+ssize_t TcpTransport::send(const void *data, size_t size) {
+    const char *bytes = static_cast<const char*>(data);
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::send(fd, bytes + sent, size - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd writable;
+                writable.fd = fd;
+                writable.events = POLLOUT;
+                writable.revents = 0;
+                int ready = poll(&writable, 1, TIMEOUT_VALUE * 1000);
+                if (ready > 0 || (ready < 0 && errno == EINTR)) continue;
+                errno = EAGAIN;
+            }
+            return -1;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(sent);
+}
+
+ssize_t TcpTransport::receive(void *buffer, size_t size) {
+    return ::read(fd, buffer, size);
+}
+
+void TcpTransport::close() {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool TcpTransport::isOpen() const {
+    return fd != -1;
+}
+
+int TcpTransport::getFd() const {
+    return fd;
+}
+
+/// @brief Constructor, see createPair()
+LoopbackTransport::LoopbackTransport(std::shared_ptr<LoopbackChannel> in, std::shared_ptr<LoopbackChannel> out, int timeout)
+    : in(in), out(out), timeout(timeout) {}
+
+LoopbackTransport::~LoopbackTransport() {
+    close();
+}
+
+/**
+ * @brief Create two transports connected to each other : what one sends, the other receives.
+ * Receives time out after TIMEOUT_VALUE seconds, like the TCP connections.
+ *
+ * @param first
+ * @param second
+ */
+void LoopbackTransport::createPair(std::unique_ptr<Transport> &first, std::unique_ptr<Transport> &second) {
+    std::shared_ptr<LoopbackChannel> forward = std::make_shared<LoopbackChannel>();
+    std::shared_ptr<LoopbackChannel> backward = std::make_shared<LoopbackChannel>();
+    first.reset(new LoopbackTransport(backward, forward, TIMEOUT_VALUE));
+    second.reset(new LoopbackTransport(forward, backward, TIMEOUT_VALUE));
+}
+
+/**
+ * @brief Queue a buffer for the other end. Never blocks.
+ *
+ * @param data
+ * @param size
+ * @return size, -1 if either end is closed
+ */
+ssize_t LoopbackTransport::send(const void *data, size_t size) {
+    if (!out) {
+        errno = EBADF;
+        return -1;
+    }
+    std::lock_guard<std::mutex> guard(out->lock);
+    if (out->closed) {
+        errno = EPIPE;
+        return -1;
+    }
+    out->bytes.append(static_cast<const char*>(data), size);
+    out->ready.notify_one();
+    return static_cast<ssize_t>(size);
+}
+
+/**
+ * @brief Take up to size bytes sent by the other end, waiting for them if there are none yet.
+ *
+ * @param buffer
+ * @param size
+ * @return The number of bytes received, 0 if the other end closed, -1 on timeout
+ */
+ssize_t LoopbackTransport::receive(void *buffer, size_t size) {
+    if (!in) {
+        errno = EBADF;
+        return -1;
+    }
+    std::unique_lock<std::mutex> guard(in->lock);
+    bool ready = in->ready.wait_for(guard, std::chrono::seconds(timeout), [&]() {
+        return in->offset < in->bytes.size() || in->closed;
+    });
+    if (!ready) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    size_t available = in->bytes.size() - in->offset;
+    if (available == 0) {
+        return 0;
+    }
+    size_t n = available < size ? available : size;
+    memcpy(buffer, in->bytes.data() + in->offset, n);
+    in->offset += n;
+    if (in->offset == in->bytes.size()) {
+        // Keep the capacity, the next messages are about the same size
+        in->bytes.clear();
+        in->offset = 0;
+    }
+    return static_cast<ssize_t>(n);
+}
+
+/// @brief Close both directions. The other end still receives what was sent before, then 0.
+void LoopbackTransport::close() {
+    for (std::shared_ptr<LoopbackChannel> *channel : {&in, &out}) {
+        if (*channel) {
+            std::lock_guard<std::mutex> guard((*channel)->lock);
+            (*channel)->closed = true;
+            (*channel)->ready.notify_all();
+        }
+        channel->reset();
+    }
+}
+
+bool LoopbackTransport::isOpen() const {
+    return in && out;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file Transport.hpp
+ * @brief Transport classes header
+ *
+ * This file holds the byte streams a SocketModule sends its messages over : a TCP connection, or an
+ * in-memory pair linking two UAVs of the same process. The loopback pair lets the measurements time
+ * the protocol alone, without the kernel and the network, and run both UAVs in a single process.
+ *
+ */
+
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+
+/// @brief Connected byte stream. receive() has the semantics of read() on a socket with a receive
+/// timeout : 0 when the peer closed the stream, -1 with errno set to EAGAIN on timeout.
+class Transport {
+public:
+    virtual ~Transport();
+
+    virtual ssize_t send(const void *data, size_t size) = 0;
+    virtual ssize_t receive(void *buffer, size_t size) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+    virtual int getFd() const;
+};
+
+/// @brief Transport over a connected TCP socket. It owns the socket.
+class TcpTransport : public Transport {
+private:
+    int fd;
+
+public:
+    explicit TcpTransport(int fd);
+    ~TcpTransport();
+
+    // Delete copy constructor and copy assignment operator
+    TcpTransport(const TcpTransport&) = delete;
+    TcpTransport& operator=(const TcpTransport&) = delete;
+
+    ssize_t send(const void *data, size_t size) override;
+    ssize_t receive(void *buffer, size_t size) override;
+    void close() override;
+    bool isOpen() const override;
+    int getFd() const override;
+};
+
+/// @brief One direction of a loopback pair
+struct LoopbackChannel {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::string bytes;
+    size_t offset = 0;      // Bytes of the buffer already received
+    bool closed = false;
+};
+
+/// @brief In-memory transport. The two ends of a pair are made by createPair() and can be used from two
+/// threads, or from one thread as long as it only receives what was already sent : send() never blocks.
+class LoopbackTransport : public Transport {
+private:
+    std::shared_ptr<LoopbackChannel> in;
+    std::shared_ptr<LoopbackChannel> out;
+    int timeout;    // Seconds a receive waits for the peer
+
+    LoopbackTransport(std::shared_ptr<LoopbackChannel> in, std::shared_ptr<LoopbackChannel> out, int timeout);
+
+public:
+    ~LoopbackTransport();
+
+    static void createPair(std::unique_ptr<Transport> &first, std::unique_ptr<Transport> &second);
+
+    ssize_t send(const void *data, size_t size) override;
+    ssize_t receive(void *buffer, size_t size) override;
+    void close() override;
+    bool isOpen() const override;
+};
+
+#endif
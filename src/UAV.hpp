@@ -9,6 +9,7 @@
 #ifndef UAV_HPP
 #define UAV_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -17,66 +18,33 @@
 #include "utils.hpp"
 #include "puf.hpp"
 #include "SocketModule.hpp"
+#include "PeerStore.hpp"
+#include "PeerFile.hpp"
+#include "Tracer.hpp"
 
 #ifdef MEASUREMENTS_DETAILLED
 #include "CycleCounter.hpp"
+#include "LatencyHistogram.hpp"
 #endif
 
 #define PUF_SIZE 32  // 256 bits = 32 bytes
 
-/// @brief This class defines the data structure holded by UAVs' table to describe other UAVs.
-class UAVData {
-private:
-    unsigned char* x;
-    unsigned char* c;
-    unsigned char* r;
-    unsigned char* xLock;
-    unsigned char* secret;
-
-    void updatePointer(unsigned char*& ptr, const unsigned char* newData);
-
-public:
-    UAVData(
-        const unsigned char* x = nullptr,
-        const unsigned char* c = nullptr,
-        const unsigned char* r = nullptr,
-        const unsigned char* xLock = nullptr,
-        const unsigned char* secret = nullptr
-    );
-
-    ~UAVData();
-    UAVData(const UAVData& other);
-    UAVData& operator=(const UAVData& other);
-
-    const unsigned char* getX() const;
-    const unsigned char* getC() const;
-    const unsigned char* getR() const;
-    const unsigned char* getXLock() const;
-    const unsigned char* getSecret() const;
-
-    void setX(const unsigned char* newX);
-    void setC(const unsigned char* newC);
-    void setR(const unsigned char* newR);
-    void setXLock(const unsigned char* newXLock);
-    void setSecret(const unsigned char* newSecret);
-
-    void print() const;
-};
-
 /// @brief This class represents a UAV. It provides methods to manage its neighbours and access its PUF.
 class UAV {
 private:
     std::string id;
-    std::unordered_map<std::string, UAVData> uavTable;
+    PeerStore uavTable;
+    std::unique_ptr<PeerFile> peerFile;     // nullptr when the UAV table is only kept in memory
     const puf PUF;
 
 public:
     SocketModule socketModule; 
     UAV(std::string id);
     UAV(std::string id, unsigned char * salt);
+    UAV(std::string id, const std::string& storePath);
     std::string getId();
     
-    void addUAV(
+    PeerHandle addUAV(
         const std::string& id, 
         const unsigned char* x = nullptr,
         const unsigned char* c = nullptr,
@@ -85,23 +53,39 @@ public:
         const unsigned char* secret = nullptr
     );
     
+    PeerHandle setUAV(
+        const std::string& id, 
+        const unsigned char* x = nullptr,
+        const unsigned char* c = nullptr,
+        const unsigned char* r = nullptr,
+        const unsigned char* xLock = nullptr,
+        const unsigned char* secret = nullptr
+    );
+
     bool removeUAV(const std::string& id);
     
-    UAVData* getUAVData(const std::string& id);
+    PeerHandle findUAV(const std::string& id);
+    bool readUAV(PeerHandle peer, UAVData& data);
+    bool commitUAV(PeerHandle peer, const unsigned char* expectedR, const unsigned char* newX, const unsigned char* newR);
+    bool updateUAV(PeerHandle peer, const std::function<void(UAVData& data)>& change);
+    void reserveUAVs(size_t count);
+    void saveUAV(PeerHandle peer);
 
     void callPUF(const unsigned char * input, unsigned char * response);
+    void callPUFBatch(const unsigned char (*input)[PUF_SIZE], size_t n, unsigned char (*response)[PUF_SIZE]);
 
     int enrolment_client();
     int enrolment_server();
-    int autentication_client();
+    int enrolment_server_pipelined();
+    int autentication_client(const std::string& peerId);
     int autentication_server();
-    int autentication_key_client();
+    int autentication_key_client(const std::string& peerId);
     int autentication_key_server();
     int preEnrolment();
-    int preEnrolmentRetrival();
+    int preEnrolmentRetrival(const std::string& peerId);
     int supplementaryAuthenticationSup();
     int supplementaryAuthenticationInitial();
-    int failed_autentication_client();
+    int failed_autentication_client(const std::string& peerId);
     // void printSalt(){
     //     PUF.printSalt();
     // }
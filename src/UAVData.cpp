@@ -0,0 +1,52 @@
+/**
+ * @file UAVData.cpp
+ * @brief UAVData class implementation
+ *
+ * This file holds the UAVData class implementation.
+ *
+ */
+
+#include "UAVData.hpp"
+
+/// @brief Constructor
+UAVData::UAVData(
+    const unsigned char* x, const unsigned char* c, const unsigned char* r, 
+    const unsigned char* xLock, const unsigned char* secret
+) : present(0) {
+    setX(x);
+    setC(c);
+    setR(r);
+    setXLock(xLock);
+    setSecret(secret);
+}
+
+/// @brief Getter Methods
+const unsigned char* UAVData::getX() const { return getField(x, FIELD_X); }
+const unsigned char* UAVData::getC() const { return getField(c, FIELD_C); }
+const unsigned char* UAVData::getR() const { return getField(r, FIELD_R); }
+const unsigned char* UAVData::getXLock() const { return getField(xLock, FIELD_XLOCK); }
+const unsigned char* UAVData::getSecret() const { return getField(secret, FIELD_SECRET); }
+
+/// @brief Setter Methods
+void UAVData::setX(const unsigned char* newX) { setField(x, FIELD_X, newX); }
+void UAVData::setC(const unsigned char* newC) { setField(c, FIELD_C, newC); }
+void UAVData::setR(const unsigned char* newR) { setField(r, FIELD_R, newR); }
+void UAVData::setXLock(const unsigned char* newXLock) { setField(xLock, FIELD_XLOCK, newXLock); }
+void UAVData::setSecret(const unsigned char* newSecret) { setField(secret, FIELD_SECRET, newSecret); }
+
+/// @brief Helper function returning a value, or nullptr when it was never set
+const unsigned char* UAVData::getField(const std::array<uint8_t, PUF_SIZE>& field, Field bit) const {
+    return (present & bit) ? field.data() : nullptr;
+}
+
+/// @brief Helper function to update a value, nullptr clears it
+void UAVData::setField(std::array<uint8_t, PUF_SIZE>& field, Field bit, const unsigned char* newData) {
+    if (newData) {
+        // The new value may be this very field, returned by a getter
+        memmove(field.data(), newData, PUF_SIZE);
+        present |= bit;
+    } else {
+        memset(field.data(), 0, PUF_SIZE);
+        present &= ~bit;
+    }
+}
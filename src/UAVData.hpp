@@ -0,0 +1,66 @@
+/**
+ * @file UAVData.hpp
+ * @brief UAVData class header
+ *
+ * This file holds the UAVData class header, the values a UAV keeps about another UAV.
+ *
+ */
+
+#ifndef UAVDATA_HPP
+#define UAVDATA_HPP
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "utils.hpp"
+
+/// @brief This class defines the data structure holded by UAVs' table to describe other UAVs.
+/// The values are stored inline and a bitmask tells which ones are set : no allocation, trivially copyable.
+class UAVData {
+private:
+    enum Field : uint8_t {
+        FIELD_X = 1 << 0,
+        FIELD_C = 1 << 1,
+        FIELD_R = 1 << 2,
+        FIELD_XLOCK = 1 << 3,
+        FIELD_SECRET = 1 << 4
+    };
+
+    std::array<uint8_t, PUF_SIZE> x;
+    std::array<uint8_t, PUF_SIZE> c;
+    std::array<uint8_t, PUF_SIZE> r;
+    std::array<uint8_t, PUF_SIZE> xLock;
+    std::array<uint8_t, PUF_SIZE> secret;
+    uint8_t present;
+
+    const unsigned char* getField(const std::array<uint8_t, PUF_SIZE>& field, Field bit) const;
+    void setField(std::array<uint8_t, PUF_SIZE>& field, Field bit, const unsigned char* newData);
+
+public:
+    UAVData(
+        const unsigned char* x = nullptr,
+        const unsigned char* c = nullptr,
+        const unsigned char* r = nullptr,
+        const unsigned char* xLock = nullptr,
+        const unsigned char* secret = nullptr
+    );
+
+    const unsigned char* getX() const;
+    const unsigned char* getC() const;
+    const unsigned char* getR() const;
+    const unsigned char* getXLock() const;
+    const unsigned char* getSecret() const;
+
+    void setX(const unsigned char* newX);
+    void setC(const unsigned char* newC);
+    void setR(const unsigned char* newR);
+    void setXLock(const unsigned char* newXLock);
+    void setSecret(const unsigned char* newSecret);
+
+    void print() const;
+};
+
+static_assert(std::is_trivially_copyable<UAVData>::value, "UAVData must stay a plain block of bytes");
+
+#endif
@@ -0,0 +1,217 @@
+/**
+ * @file WireFormat.cpp
+ * @brief Compact binary wire format implementation
+ *
+ * This file holds the layout of every binary frame and the conversions from and to msgPack style maps.
+ *
+ */
+
+#include "WireFormat.hpp"
+
+/// @brief Field names of a frame type. A key may span several consecutive 32 bytes fields.
+struct WireLayout {
+    uint8_t keyCount;
+    const char *keys[3];
+    uint8_t slots[3];
+};
+
+// Indexed by WireType
+static const WireLayout layouts[] = {
+    {0, {nullptr, nullptr, nullptr}, {0, 0, 0}},                // WIRE_INVALID
+    {0, {nullptr, nullptr, nullptr}, {0, 0, 0}},                // WIRE_ID
+    {1, {"CB", nullptr, nullptr}, {1, 0, 0}},                   // WIRE_CB
+    {1, {"RB", nullptr, nullptr}, {1, 0, 0}},                   // WIRE_RB
+    {1, {"CA", nullptr, nullptr}, {1, 0, 0}},                   // WIRE_CA
+    {1, {"RA", nullptr, nullptr}, {1, 0, 0}},                   // WIRE_RA
+    {1, {"M0", nullptr, nullptr}, {1, 0, 0}},                   // WIRE_M0
+    {2, {"M1", "hash1", nullptr}, {1, 1, 0}},                   // WIRE_M1
+    {2, {"M2", "hash2", nullptr}, {1, 1, 0}},                   // WIRE_M2
+    {3, {"M2", "MK", "hash2"}, {1, 1, 1}},                      // WIRE_M2_KEY
+    {1, {"hash3", nullptr, nullptr}, {1, 0, 0}},                // WIRE_HASH3
+    {1, {"NA", nullptr, nullptr}, {1, 0, 0}},                   // WIRE_NA
+    {3, {"CA", "M1", "hash1"}, {1, 1, 1}},                      // WIRE_SUPP_M1
+    {2, {"CA", "RA", nullptr}, {1, 1, 0}},                      // WIRE_CREDENTIALS
+    {1, {"data", nullptr, nullptr}, {CHALLENGE_SIZE, 0, 0}},    // WIRE_DATA
+    {1, {"value", nullptr, nullptr}, {1, 0, 0}},                // WIRE_VALUE
+    {2, {"RB", "CA", nullptr}, {1, 1, 0}},                      // WIRE_RB_CA
+};
+
+static const size_t layoutCount = sizeof(layouts) / sizeof(layouts[0]);
+
+static_assert(sizeof(WireFrame) == WIRE_HEADER_SIZE + WIRE_MAX_FIELDS * PUF_SIZE, "WireFrame must not be padded");
+
+/// @brief Total number of 32 bytes fields of a layout
+static uint8_t layoutFields(const WireLayout &layout) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < layout.keyCount; i++) {
+        count += layout.slots[i];
+    }
+    return count;
+}
+
+bool wireInit(WireFrame &frame, WireType type, const std::string &id) {
+    if (type == WIRE_INVALID || type >= layoutCount || id.size() > WIRE_ID_SIZE) {
+        return false;
+    }
+    frame.magic = WIRE_MAGIC;
+    frame.type = type;
+    frame.fieldCount = layoutFields(layouts[type]);
+    frame.idLength = static_cast<uint8_t>(id.size());
+    memcpy(frame.id, id.data(), id.size());
+    return true;
+}
+
+size_t wireSize(const WireFrame &frame) {
+    return WIRE_HEADER_SIZE + static_cast<size_t>(frame.fieldCount) * PUF_SIZE;
+}
+
+size_t wireFrameSize(const unsigned char *header) {
+    const WireFrame *frame = reinterpret_cast<const WireFrame*>(header);
+    if (frame->magic != WIRE_MAGIC || frame->type == WIRE_INVALID || frame->type >= layoutCount
+        || frame->idLength > WIRE_ID_SIZE || frame->fieldCount != layoutFields(layouts[frame->type])) {
+        return 0;
+    }
+    return wireSize(*frame);
+}
+
+std::string wireId(const WireFrame &frame) {
+    return std::string(frame.id, frame.idLength);
+}
+
+bool wireFromMap(const std::unordered_map<std::string, std::string> &msg, WireFrame &frame) {
+    auto idIt = msg.find("id");
+    size_t keyCount = msg.size() - (idIt != msg.end() ? 1 : 0);
+
+    for (size_t type = WIRE_ID; type < layoutCount; type++) {
+        const WireLayout &layout = layouts[type];
+        if (layout.keyCount != keyCount) continue;
+
+        bool match = true;
+        for (uint8_t k = 0; k < layout.keyCount && match; k++) {
+            auto it = msg.find(layout.keys[k]);
+            match = it != msg.end() && it->second.size() == static_cast<size_t>(layout.slots[k]) * PUF_SIZE;
+        }
+        if (!match) continue;
+
+        if (!wireInit(frame, static_cast<WireType>(type), idIt != msg.end() ? idIt->second : std::string())) {
+            return false;
+        }
+        unsigned char *field = frame.fields[0];
+        for (uint8_t k = 0; k < layout.keyCount; k++) {
+            const std::string &value = msg.find(layout.keys[k])->second;
+            memcpy(field, value.data(), value.size());
+            field += value.size();
+        }
+        return true;
+    }
+    return false;
+}
+
+/// @brief Small adapter letting msgpack pack directly into an output string.
+struct StringWriter {
+    std::string &target;
+    explicit StringWriter(std::string &target) : target(target) {}
+    void write(const char *data, size_t size) { target.append(data, size); }
+};
+
+bool wireAppend(std::string &out, const std::unordered_map<std::string, std::string> &msg, bool binary) {
+    WireFrame frame;
+    if (binary && wireFromMap(msg, frame)) {
+        out.append(reinterpret_cast<const char*>(&frame), wireSize(frame));
+        return true;
+    }
+    StringWriter writer(out);
+    msgpack::pack(writer, msg);
+    return false;
+}
+
+bool wireToMap(const WireFrame &frame, std::unordered_map<std::string, std::string> &msg) {
+    if (frame.type == WIRE_INVALID || frame.type >= layoutCount) {
+        return false;
+    }
+    const WireLayout &layout = layouts[frame.type];
+
+    msg.reserve(layout.keyCount + 1);
+    if (frame.idLength > 0) {
+        msg.emplace("id", wireId(frame));
+    }
+    const unsigned char *field = frame.fields[0];
+    for (uint8_t k = 0; k < layout.keyCount; k++) {
+        size_t size = static_cast<size_t>(layout.slots[k]) * PUF_SIZE;
+        msg.emplace(layout.keys[k], std::string(reinterpret_cast<const char*>(field), size));
+        field += size;
+    }
+    return true;
+}
+
+const unsigned char* wireFind(const WireFrame &frame, const char *key, size_t &size) {
+    if (frame.type == WIRE_INVALID || frame.type >= layoutCount) {
+        return nullptr;
+    }
+    const WireLayout &layout = layouts[frame.type];
+
+    const unsigned char *field = frame.fields[0];
+    for (uint8_t k = 0; k < layout.keyCount; k++) {
+        size_t fieldSize = static_cast<size_t>(layout.slots[k]) * PUF_SIZE;
+        if (strcmp(layout.keys[k], key) == 0) {
+            size = fieldSize;
+            return field;
+        }
+        field += fieldSize;
+    }
+    return nullptr;
+}
+
+void wireForEach(const WireFrame &frame, const std::function<void(const char *key, const unsigned char *data, size_t size)> &visit) {
+    if (frame.type == WIRE_INVALID || frame.type >= layoutCount) {
+        return;
+    }
+    const WireLayout &layout = layouts[frame.type];
+
+    const unsigned char *field = frame.fields[0];
+    for (uint8_t k = 0; k < layout.keyCount; k++) {
+        size_t size = static_cast<size_t>(layout.slots[k]) * PUF_SIZE;
+        visit(layout.keys[k], field, size);
+        field += size;
+    }
+}
+
+WireParse wirePeekNext(msgpack::unpacker &pac, msgpack::object_handle &msgpack_obj, const WireFrame *&frame, size_t &frameSize) {
+    if (pac.nonparsed_size() == 0) {
+        return WIRE_PARSE_NEED_MORE;
+    }
+
+    // A msgPack message split across reads leaves the offset inside it, only look for a frame between messages
+    const unsigned char *data = reinterpret_cast<const unsigned char*>(pac.nonparsed_buffer());
+    if (pac.parsed_size() == 0 && data[0] == WIRE_MAGIC) {
+        if (pac.nonparsed_size() < WIRE_HEADER_SIZE) {
+            return WIRE_PARSE_NEED_MORE;
+        }
+        frameSize = wireFrameSize(data);
+        if (frameSize == 0) {
+            return WIRE_PARSE_INVALID;
+        }
+        if (pac.nonparsed_size() < frameSize) {
+            return WIRE_PARSE_NEED_MORE;
+        }
+        frame = reinterpret_cast<const WireFrame*>(data);
+        return WIRE_PARSE_FRAME;
+    }
+
+    if (pac.next(msgpack_obj)) {
+        return msgpack_obj.get().type == msgpack::type::MAP ? WIRE_PARSE_MSGPACK : WIRE_PARSE_INVALID;
+    }
+    return WIRE_PARSE_NEED_MORE;
+}
+
+WireParse wireParseNext(msgpack::unpacker &pac, msgpack::object_handle &msgpack_obj, WireFrame &frame) {
+    const WireFrame *view = nullptr;
+    size_t size = 0;
+
+    WireParse parsed = wirePeekNext(pac, msgpack_obj, view, size);
+    if (parsed == WIRE_PARSE_FRAME) {
+        memcpy(&frame, view, size);
+        pac.skip_nonparsed_buffer(size);
+    }
+    return parsed;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file WireFormat.hpp
+ * @brief Compact binary wire format header
+ *
+ * This file holds the fixed-layout binary frames that can replace the msgPack maps on a connection.
+ * A frame is a message type byte followed by fixed 32 bytes fields : no keys and no heap.
+ *
+ */
+
+#ifndef WIREFORMAT_HPP
+#define WIREFORMAT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <msgpack.hpp>
+
+#include "utils.hpp"
+
+// 0xC1 is never a msgPack type byte, so a frame can not be mistaken for a msgPack message starting at the same offset
+#define WIRE_MAGIC 0xC1
+#define WIRE_ID_SIZE 28
+#define WIRE_HEADER_SIZE (4 + WIRE_ID_SIZE)
+#define WIRE_MAX_FIELDS CHALLENGE_SIZE
+
+/// @brief The protocol messages. The order of the fields of each type is fixed in WireFormat.cpp.
+enum WireType : uint8_t {
+    WIRE_INVALID = 0,
+    WIRE_ID,            // id only, opens the supplementary authentication
+    WIRE_CB,
+    WIRE_RB,
+    WIRE_CA,
+    WIRE_RA,
+    WIRE_M0,
+    WIRE_M1,            // M1, hash1
+    WIRE_M2,            // M2, hash2
+    WIRE_M2_KEY,        // M2, MK, hash2
+    WIRE_HASH3,
+    WIRE_NA,
+    WIRE_SUPP_M1,       // CA, M1, hash1
+    WIRE_CREDENTIALS,   // CA, RA
+    WIRE_DATA,          // CHALLENGE_SIZE challenges or responses
+    WIRE_VALUE,         // Used by the serialization benchmarks
+    WIRE_RB_CA          // RB, CA : answer of the pipelined enrolment
+};
+
+/// @brief Outcome of wireParseNext()
+enum WireParse {
+    WIRE_PARSE_INVALID = -1,
+    WIRE_PARSE_NEED_MORE = 0,
+    WIRE_PARSE_MSGPACK = 1,
+    WIRE_PARSE_FRAME = 2
+};
+
+/// @brief One protocol message. Only the first wireSize() bytes are sent.
+struct WireFrame {
+    uint8_t magic;
+    uint8_t type;
+    uint8_t fieldCount;
+    uint8_t idLength;
+    char id[WIRE_ID_SIZE];
+    unsigned char fields[WIRE_MAX_FIELDS][PUF_SIZE];
+};
+
+/**
+ * @brief Prepare a frame of the given type.
+ *
+ * @param frame
+ * @param type
+ * @param id
+ * @return false if the type is unknown or the id too long
+ */
+bool wireInit(WireFrame &frame, WireType type, const std::string &id);
+
+/**
+ * @brief Number of bytes of the frame that go on the wire.
+ *
+ * @param frame
+ * @return size_t
+ */
+size_t wireSize(const WireFrame &frame);
+
+/**
+ * @brief Check a received header and return the size of the whole frame, 0 if the header is invalid.
+ *
+ * @param header At least WIRE_HEADER_SIZE bytes
+ * @return size_t
+ */
+size_t wireFrameSize(const unsigned char *header);
+
+/**
+ * @brief Get the id carried by the frame.
+ *
+ * @param frame
+ * @return std::string
+ */
+std::string wireId(const WireFrame &frame);
+
+/**
+ * @brief Convert a msgPack style map to a frame. Maps matching no known message are left to msgPack.
+ *
+ * @param msg
+ * @param frame
+ * @return true if the map has a binary layout
+ */
+bool wireFromMap(const std::unordered_map<std::string, std::string> &msg, WireFrame &frame);
+
+/**
+ * @brief Append a message to an output buffer : as a frame when binary is set and the map has a binary layout,
+ * as a msgPack map otherwise. Several messages appended before a send leave in one syscall.
+ *
+ * @param out The buffer, reused from send to send
+ * @param msg
+ * @param binary
+ * @return true if the message was appended as a frame
+ */
+bool wireAppend(std::string &out, const std::unordered_map<std::string, std::string> &msg, bool binary);
+
+/**
+ * @brief Convert a frame back to a msgPack style map.
+ *
+ * @param frame
+ * @param msg
+ * @return false if the frame type is unknown
+ */
+bool wireToMap(const WireFrame &frame, std::unordered_map<std::string, std::string> &msg);
+
+/**
+ * @brief Find the value of a key inside a frame, without copying it.
+ *
+ * @param frame
+ * @param key
+ * @param size Set to the size of the value
+ * @return Pointer to the value inside the frame, nullptr if the frame has no such key
+ */
+const unsigned char* wireFind(const WireFrame &frame, const char *key, size_t &size);
+
+/**
+ * @brief Call a function on every key and value of a frame.
+ *
+ * @param frame
+ * @param visit
+ */
+void wireForEach(const WireFrame &frame, const std::function<void(const char *key, const unsigned char *data, size_t size)> &visit);
+
+/**
+ * @brief Look at the next message buffered in an unpacker without consuming a binary frame.
+ * A frame stays in the unpacker buffer, the caller skips frameSize bytes once it is done with it.
+ * The magic byte is only looked for at a message boundary, a msgPack message can hold that byte.
+ *
+ * @param pac
+ * @param msgpack_obj Filled when a msgPack message is available
+ * @param frame Points into the unpacker buffer when a binary frame is available
+ * @param frameSize Size of that frame
+ * @return WireParse
+ */
+WireParse wirePeekNext(msgpack::unpacker &pac, msgpack::object_handle &msgpack_obj, const WireFrame *&frame, size_t &frameSize);
+
+/**
+ * @brief Extract the next message buffered in an unpacker, whichever format the peer used.
+ *
+ * @param pac
+ * @param msgpack_obj Filled when a msgPack message is available
+ * @param frame Filled when a binary frame is available
+ * @return WireParse
+ */
+WireParse wireParseNext(msgpack::unpacker &pac, msgpack::object_handle &msgpack_obj, WireFrame &frame);
+
+#endif
@@ -0,0 +1,200 @@
+/**
+ * @file drbg.cpp
+ * @brief Random generator implementation
+ *
+ * This file holds the per thread ChaCha20 generator. The layout follows arc4random : a refill runs
+ * ChaCha20 over the key and the buffer at once, the key part is used to rekey and then wiped.
+ *
+ */
+
+#include "drbg.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <pthread.h>
+#include <sys/random.h>
+
+#define DRBG_KEY_SIZE 32
+#define DRBG_BLOCK_SIZE 64
+#define DRBG_STREAM_SIZE (DRBG_KEY_SIZE + DRBG_BUFFER_SIZE)
+
+static_assert(DRBG_STREAM_SIZE % DRBG_BLOCK_SIZE == 0, "A refill must be a whole number of ChaCha20 blocks");
+
+// Not optimised out, even on a state that is never read again
+static void * (* const volatile wipe)(void *, int, size_t) = memset;
+
+// Bumped in a forked child, so every thread state inherited from the parent reseeds
+static std::atomic<unsigned> forkGeneration(0);
+
+static void onFork() {
+    forkGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// @brief Random state of one thread. The bytes left to serve are the last available bytes of stream.
+struct DrbgState {
+    uint32_t key[8];
+    unsigned char stream[DRBG_STREAM_SIZE];
+    size_t available;
+    unsigned generation;
+    bool seeded;
+
+    DrbgState() : available(0), generation(0), seeded(false) {}
+    ~DrbgState() { wipe(this, 0, sizeof(*this)); }
+};
+
+static thread_local DrbgState state;
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL(d, 16); \
+    c += d; b ^= c; b = ROTL(b, 12); \
+    a += b; d ^= a; d = ROTL(d, 8);  \
+    c += d; b ^= c; b = ROTL(b, 7);
+
+static inline uint32_t load_le32(const unsigned char * p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+         | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static inline void store_le32(unsigned char * p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v);
+    p[1] = static_cast<unsigned char>(v >> 8);
+    p[2] = static_cast<unsigned char>(v >> 16);
+    p[3] = static_cast<unsigned char>(v >> 24);
+}
+
+/**
+ * @brief ChaCha20 keystream, 20 rounds, zero nonce. The key changes at every refill so the nonce never repeats.
+ *
+ * @param key
+ * @param output blocks * 64 bytes
+ * @param blocks
+ */
+static void chacha20_blocks(const uint32_t * key, unsigned char * output, size_t blocks) {
+    uint32_t input[16] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+        0, 0, 0, 0
+    };
+
+    for (size_t block = 0; block < blocks; block++) {
+        uint32_t x[16];
+        memcpy(x, input, sizeof(x));
+
+        for (int i = 0; i < 10; i++) {
+            QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+            QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+            QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+            QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+            QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+            QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+            QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+            QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+        }
+
+        for (int i = 0; i < 16; i++) {
+            store_le32(output + 4 * i, x[i] + input[i]);
+        }
+        output += DRBG_BLOCK_SIZE;
+
+        // 64 bits block counter
+        if (++input[12] == 0) {
+            input[13]++;
+        }
+    }
+}
+
+/**
+ * @brief Get the seed from the kernel. Falls back on std::random_device when getrandom() is not available.
+ *
+ * @param seed DRBG_KEY_SIZE bytes
+ */
+static void drbg_seed(unsigned char * seed) {
+    size_t done = 0;
+    while (done < DRBG_KEY_SIZE) {
+        ssize_t n = getrandom(seed + done, DRBG_KEY_SIZE - done, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "getrandom failed (" << strerror(errno) << "), seeding from std::random_device.\n";
+            std::random_device rd;
+            for (size_t i = 0; i < DRBG_KEY_SIZE; i += sizeof(unsigned int)) {
+                unsigned int value = rd();
+                memcpy(seed + i, &value, sizeof(value));
+            }
+            return;
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+/// @brief Produce a new buffer of random bytes and move to the next key.
+static void drbg_refill(DrbgState &s) {
+    chacha20_blocks(s.key, s.stream, DRBG_STREAM_SIZE / DRBG_BLOCK_SIZE);
+    for (int i = 0; i < 8; i++) {
+        s.key[i] = load_le32(s.stream + 4 * i);
+    }
+    memset(s.stream, 0, DRBG_KEY_SIZE);
+    s.available = DRBG_BUFFER_SIZE;
+}
+
+/// @brief Seed the state of the calling thread on first use, and again in a forked child.
+static inline DrbgState& drbg_state() {
+    DrbgState &s = state;
+    unsigned generation = forkGeneration.load(std::memory_order_relaxed);
+    if (__builtin_expect(!s.seeded || s.generation != generation, 0)) {
+        static const int atforkRegistered = pthread_atfork(nullptr, nullptr, onFork);
+        (void)atforkRegistered;
+
+        unsigned char seed[DRBG_KEY_SIZE];
+        drbg_seed(seed);
+        for (int i = 0; i < 8; i++) {
+            s.key[i] = load_le32(seed + 4 * i);
+        }
+        wipe(seed, 0, sizeof(seed));
+
+        // Drop whatever the parent had buffered
+        memset(s.stream, 0, sizeof(s.stream));
+        s.available = 0;
+        s.generation = generation;
+        s.seeded = true;
+    }
+    return s;
+}
+
+void drbg_generate(unsigned char * buffer, size_t size) {
+    DrbgState &s = drbg_state();
+
+    while (size > 0) {
+        if (s.available == 0) {
+            drbg_refill(s);
+        }
+        size_t count = size < s.available ? size : s.available;
+        unsigned char * bytes = s.stream + DRBG_STREAM_SIZE - s.available;
+        memcpy(buffer, bytes, count);
+        memset(bytes, 0, count);
+
+        buffer += count;
+        size -= count;
+        s.available -= count;
+    }
+}
+
+void drbg_fill(size_t size) {
+    DrbgState &s = drbg_state();
+    if (size > DRBG_BUFFER_SIZE) {
+        size = DRBG_BUFFER_SIZE;
+    }
+    if (s.available < size) {
+        // The bytes left are dropped, they are wiped by the refill
+        drbg_refill(s);
+    }
+}
+
+size_t drbg_available() {
+    return state.available;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file drbg.hpp
+ * @brief Random generator header
+ *
+ * This file holds the random generator behind generate_random_bytes(). Each thread runs its own
+ * ChaCha20 generator, seeded once from getrandom(), which fills a buffer of random bytes ahead of time.
+ * The first 32 bytes of every refill become the next key and served bytes are wiped, so bytes already
+ * given out can not be recovered from the state. A forked child reseeds before its first use.
+ *
+ */
+
+#ifndef DRBG_HPP
+#define DRBG_HPP
+
+#include <cstddef>
+
+// Random bytes produced by one refill of a thread buffer
+#define DRBG_BUFFER_SIZE 4064
+// Bytes kept ready before waiting for the network : the nonces of several handshakes
+#define DRBG_PREFILL_SIZE 512
+
+/**
+ * @brief Write random bytes from the buffer of the calling thread, refilling it when empty.
+ *
+ * @param buffer
+ * @param size
+ */
+void drbg_generate(unsigned char * buffer, size_t size);
+
+/**
+ * @brief Make sure the next size bytes (at most DRBG_BUFFER_SIZE) are already buffered, so they are
+ * served without running ChaCha20. Meant to be called while idle, e.g. before waiting for a message.
+ *
+ * @param size
+ */
+void drbg_fill(size_t size = DRBG_BUFFER_SIZE);
+
+/**
+ * @brief Number of random bytes buffered for the calling thread.
+ *
+ * @return size_t
+ */
+size_t drbg_available();
+
+#endif
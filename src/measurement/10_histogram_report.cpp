@@ -0,0 +1,26 @@
+/**
+ * @file 10_histogram_report.cpp
+ * @brief This file's goal is to sum up many runs of the overheads measurements. Built with MEASUREMENTS_DETAILLED,
+ * the binaries 1 to 4 append the operational, idle and total cycles of every protocol they ran to histograms.txt.
+ * This tool merges the histograms of one or several such files, e.g. one per UAV, and prints the p50, p90, p99,
+ * p99.9 and max of each, so tail latencies show without post-processing every printout.
+ * Usage : ./10_histogram_report [files = histograms.txt]
+ *
+ */
+
+#include <string>
+
+#include "../LatencyHistogram.hpp"
+
+int main(int argc, char* argv[]) {
+    int ret = 0;
+    if (argc < 2) {
+        ret = LatencyHistogram::loadAll("histograms.txt");
+    }
+    for (int i = 1; i < argc; i++) {
+        ret |= LatencyHistogram::loadAll(argv[i]);
+    }
+
+    LatencyHistogram::printAll(std::cout, "cycles");
+    return ret;
+}
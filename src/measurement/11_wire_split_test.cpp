@@ -0,0 +1,81 @@
+/**
+ * @file 11_wire_split_test.cpp
+ * @brief This file's goal is to check that messages received one byte at a time are read as sent.
+ *
+ * A msgPack map whose values hold the frame magic byte is mixed with binary frames, the stream is given
+ * to the unpacker one byte at a time and every message has to come out whole and in order.
+ *
+ */
+
+#include "../WireFormat.hpp"
+#include "../utils.hpp"
+
+#include <iostream>
+#include <vector>
+
+int main() {
+    // Every value starts with the magic byte, as a split message would leave it at the unpacker offset
+    std::unordered_map<std::string, std::string> msg;
+    msg["id"] = "B";
+    msg["CA"] = std::string(PUF_SIZE, static_cast<char>(WIRE_MAGIC));
+    msg["RB"] = std::string(1, static_cast<char>(WIRE_MAGIC)) + std::string(PUF_SIZE - 1, '\x01');
+
+    std::string stream;
+    std::vector<WireParse> expected;
+    for (int i = 0; i < 3; i++) {
+        bool binary = (i == 1);
+        wireAppend(stream, msg, binary);
+        expected.push_back(binary ? WIRE_PARSE_FRAME : WIRE_PARSE_MSGPACK);
+    }
+
+    msgpack::unpacker pac;
+    msgpack::object_handle msgpack_obj;
+    WireFrame frame;
+    std::vector<WireParse> received;
+    int errors = 0;
+
+    for (size_t i = 0; i < stream.size(); i++) {
+        pac.reserve_buffer(1);
+        pac.buffer()[0] = stream[i];
+        pac.buffer_consumed(1);
+
+        WireParse parsed;
+        try {
+            parsed = wireParseNext(pac, msgpack_obj, frame);
+        } catch (const std::exception &e) {
+            std::cerr << "Byte " << i << " : " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (parsed == WIRE_PARSE_INVALID) {
+            std::cerr << "Byte " << i << " : invalid message" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (parsed == WIRE_PARSE_NEED_MORE) {
+            continue;
+        }
+
+        std::unordered_map<std::string, std::string> got;
+        if (parsed == WIRE_PARSE_FRAME) {
+            wireToMap(frame, got);
+        } else {
+            const msgpack::object &map = msgpack_obj.get();
+            for (uint32_t k = 0; k < map.via.map.size; k++) {
+                const msgpack::object_kv &kv = map.via.map.ptr[k];
+                got.emplace(kv.key.as<std::string>(), kv.val.as<std::string>());
+            }
+        }
+        if (got != msg) {
+            std::cerr << "Message " << received.size() << " differs from the one sent" << std::endl;
+            errors++;
+        }
+        received.push_back(parsed);
+    }
+
+    if (received != expected) {
+        std::cerr << "Received " << received.size() << " messages, expected " << expected.size() << std::endl;
+        errors++;
+    }
+
+    std::cout << (errors ? "FAILED" : "OK") << " : " << received.size() << " messages from " << stream.size() << " bytes" << std::endl;
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file 12_session_mux_test.cpp
+ * @brief This file's goal is to check that a SessionMux keeps apart the sessions it opens and the ones it answers.
+ *
+ * Two muxes are linked back to back and both open sessions : the drones behind the first one enrol and
+ * authenticate with B, the ones behind the second with A. Both number their sessions from 0, so every id is
+ * used in both directions at once, and every session has to succeed.
+ * Usage : ./12_session_mux_test [drones per side = 4]
+ *
+ */
+
+#include "../UAV.hpp"
+#include "../utils.hpp"
+#include "../ProtocolSession.hpp"
+#include "../SessionMux.hpp"
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+/// @brief Hand the messages of one mux to the other one until neither has anything left to send
+static bool exchange(SessionMux &left, SessionMux &right, std::vector<ProtocolMessage> &toRight, std::vector<ProtocolMessage> &toLeft) {
+    while (!toRight.empty() || !toLeft.empty()) {
+        std::vector<ProtocolMessage> in;
+        in.swap(toRight);
+        for (const ProtocolMessage &msg : in) {
+            if (!right.onMessage(msg, toLeft)) return false;
+        }
+        in.clear();
+        in.swap(toLeft);
+        for (const ProtocolMessage &msg : in) {
+            if (!left.onMessage(msg, toRight)) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int drones = (argc > 1) ? std::stoi(argv[1]) : 4;
+
+    UAV A("A");
+    UAV B("B");
+    std::vector<std::unique_ptr<UAV>> behindA;
+    std::vector<std::unique_ptr<UAV>> behindB;
+    for (int i = 0; i < drones; i++) {
+        behindA.emplace_back(new UAV("C" + std::to_string(i)));
+        behindB.emplace_back(new UAV("D" + std::to_string(i)));
+    }
+
+    SessionMux left(&A);
+    SessionMux right(&B);
+    int done = 0;
+    left.onDone([&done](const std::string &, ProtocolSession &) { done++; });
+    right.onDone([&done](const std::string &, ProtocolSession &) { done++; });
+
+    std::vector<ProtocolMessage> toRight;
+    std::vector<ProtocolMessage> toLeft;
+    int errors = 0;
+
+    for (int i = 0; i < drones; i++) {
+        left.open(std::unique_ptr<ProtocolSession>(new EnrolmentClientSession(*behindA[i])), toRight);
+        right.open(std::unique_ptr<ProtocolSession>(new EnrolmentClientSession(*behindB[i])), toLeft);
+    }
+    if (!exchange(left, right, toRight, toLeft)) {
+        std::cerr << "Enrolment : a message was refused" << std::endl;
+        errors++;
+    }
+
+    for (int i = 0; i < drones; i++) {
+        left.open(std::unique_ptr<ProtocolSession>(new AuthenticationClientSession(*behindA[i], "B")), toRight);
+        right.open(std::unique_ptr<ProtocolSession>(new AuthenticationClientSession(*behindB[i], "A")), toLeft);
+    }
+    if (!exchange(left, right, toRight, toLeft)) {
+        std::cerr << "Authentication : a message was refused" << std::endl;
+        errors++;
+    }
+
+    // Each handshake ends one session on both sides
+    int expected = 2 * 2 * 2 * drones;
+    if (done != expected) {
+        std::cerr << done << " sessions ended, expected " << expected << std::endl;
+        errors++;
+    }
+    if (left.openCount() != 0 || right.openCount() != 0) {
+        std::cerr << left.openCount() + right.openCount() << " sessions still open" << std::endl;
+        errors++;
+    }
+    if (left.getFailures() != 0 || right.getFailures() != 0) {
+        std::cerr << left.getFailures() + right.getFailures() << " sessions failed" << std::endl;
+        errors++;
+    }
+
+    std::cout << (errors ? "FAILED" : "OK") << " : " << done << " sessions over two muxes" << std::endl;
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
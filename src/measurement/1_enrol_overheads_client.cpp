@@ -55,6 +55,9 @@ int main(int argc, char* argv[]) {
     totalTime = end - start;
 
     std::cout << "Enrolment procedure elapsed CPU cycles : " << totalTime << " cycles" << std::endl;
+
+    // Detailed runs add the cycles of each phase to the histograms of the previous runs, see 10_histogram_report
+    MEASURE_ONLY({LatencyHistogram::appendAll("histograms.txt");});
     A.socketModule.closeConnection();
     return 0;
 }
@@ -2,6 +2,7 @@
  * @file 1_enrol_server.cpp
  * @brief This file's goal is to measure the overheads of the enrolment function. The output is the total time taken by the function to execute. 
  * If the project is compiled with -DMEASUREMENTS, The output also includes the active and idle time of the function execution.
+ * Usage : ./1_enrol_overheads_server [--pipelined]
  * 
  */
 
@@ -25,7 +26,10 @@ long long end;
 
 CycleCounter counter;
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --pipelined sends RB and CA in one message, see UAV::enrolment_server_pipelined
+    bool pipelined = (argc > 1) && std::string(argv[1]) == "--pipelined";
+
     // Creation of the UAV
 
     UAV A(idA);
@@ -41,7 +45,7 @@ int main() {
     
     // We start the measurements
     start = counter.getCycles();
-    int ret = A.enrolment_server();
+    int ret = pipelined ? A.enrolment_server_pipelined() : A.enrolment_server();
     if (ret == 1){
         return ret;
     }
@@ -49,6 +53,9 @@ int main() {
     totalTime = end - start;
 
     std::cout << "Enrolment procedure elapsed CPU cycles : " << totalTime << " cycles" << std::endl;
+
+    // Detailed runs add the cycles of each phase to the histograms of the previous runs, see 10_histogram_report
+    MEASURE_ONLY({LatencyHistogram::appendAll("histograms.txt");});
     A.socketModule.closeConnection();
     return 0;
 }
@@ -52,7 +52,7 @@ int main(int argc, char* argv[]) {
     // We start the measurements
     start = counter.getCycles(); 
 
-    ret = A.autentication_client();
+    ret = A.autentication_client(idB);
     
     end = counter.getCycles(); 
     totalTime = end - start;
@@ -63,6 +63,9 @@ int main(int argc, char* argv[]) {
     }
 
     std::cout << "Authentication procedure elapsed CPU cycles : " << totalTime << " cycles" << std::endl;
+
+    // Detailed runs add the cycles of each phase to the histograms of the previous runs, see 10_histogram_report
+    MEASURE_ONLY({LatencyHistogram::appendAll("histograms.txt");});
     A.socketModule.closeConnection();
     return 0;
 }
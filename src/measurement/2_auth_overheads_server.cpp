@@ -54,6 +54,9 @@ int main(){
     }
 
     std::cout << "Authentication procedure elapsed CPU cycles : " << totalTime << " cycles" << std::endl;
+
+    // Detailed runs add the cycles of each phase to the histograms of the previous runs, see 10_histogram_report
+    MEASURE_ONLY({LatencyHistogram::appendAll("histograms.txt");});
     B.socketModule.closeConnection();
 
     return 0;
@@ -51,7 +51,7 @@ int main(int argc, char* argv[]) {
 
     start = counter.getCycles(); 
 
-    ret = A.autentication_key_client();
+    ret = A.autentication_key_client(idB);
     
     end = counter.getCycles(); 
     totalTime = end - start;
@@ -62,6 +62,9 @@ int main(int argc, char* argv[]) {
     }
 
     std::cout << "Authentication + key procedure elapsed CPU cycles : " << totalTime << " cycles" << std::endl;
+
+    // Detailed runs add the cycles of each phase to the histograms of the previous runs, see 10_histogram_report
+    MEASURE_ONLY({LatencyHistogram::appendAll("histograms.txt");});
     A.socketModule.closeConnection();
     return 0;
 }
@@ -59,5 +59,8 @@ int main() {
     }
 
     std::cout << "Supplementary authentication procedure elapsed CPU cycles : " << totalTime << " cycles" << std::endl;
+
+    // Detailed runs add the cycles of each phase to the histograms of the previous runs, see 10_histogram_report
+    MEASURE_ONLY({LatencyHistogram::appendAll("histograms.txt");});
     return 0;
 }
\ No newline at end of file
@@ -58,7 +58,7 @@ int main(int argc, char* argv[]) {
     fromHexString(xLstr, xL, PUF_SIZE);
     // std::cout << "xL : "; print_hex(xL, PUF_SIZE); std::cout << std::endl;
     
-    std::string secretStr = std::string("15a5796e0d20e8288d6faef881969ed81677d628e6d500d5ba8f67906daa1e29");
+    std::string secretStr = std::string("ae6dfb35854d6e9ab9fc311d595d5ceb5fffe36a940ea6d30865450e7c4f3ec2");
     unsigned char secret[PUF_SIZE];
     fromHexString(secretStr, secret, PUF_SIZE);
     // std::cout << "secret : "; print_hex(secret, PUF_SIZE); std::cout << std::endl;
@@ -78,5 +78,8 @@ int main(int argc, char* argv[]) {
     }
 
     std::cout << "Supplementary authentication procedure elapsed CPU cycles : " << totalTime << " cycles" << std::endl;
+
+    // Detailed runs add the cycles of each phase to the histograms of the previous runs, see 10_histogram_report
+    MEASURE_ONLY({LatencyHistogram::appendAll("histograms.txt");});
     return 0;
 }
\ No newline at end of file
@@ -21,9 +21,17 @@ int main(int argc, char* argv[]) {
     
     // Test a PUF computation t ocompare the two rpi
     UAV A("A");
+
+    bool doWarmup = false;
+    bool binary = false;    // Send a fixed-layout frame instead of a msgPack map
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--warmup") doWarmup = true;
+        else if (std::string(argv[i]) == "--binary") binary = true;
+    }
+
     A.socketModule.initiateConnection(ip, 8080);
     
-    if (argc > 2 && std::string(argv[2]) == "--warmup") {
+    if (doWarmup) {
         warmup();
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
     }    
@@ -33,9 +41,16 @@ int main(int argc, char* argv[]) {
     
     long long start = counter.getCycles();
     
-    std::unordered_map<std::string, std::string> msg;
-    msg.emplace("value",std::string(reinterpret_cast<const char*>(rnd), 32));
-    A.socketModule.sendMsg(msg);
+    if (binary) {
+        WireFrame frame;
+        wireInit(frame, WIRE_VALUE, "");
+        memcpy(frame.fields[0], rnd, PUF_SIZE);
+        A.socketModule.sendFrame(frame);
+    } else {
+        std::unordered_map<std::string, std::string> msg;
+        msg.emplace("value",std::string(reinterpret_cast<const char*>(rnd), 32));
+        A.socketModule.sendMsg(msg);
+    }
 
     long long end = counter.getCycles();
     long long cycle_difference = end - start;
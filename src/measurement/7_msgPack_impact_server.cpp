@@ -22,6 +22,7 @@ int main() {
     rsp.reserve(1);
     A.socketModule.receiveMsg(rsp);
     printMsg(rsp);
+    std::cout << "Format: " << (A.socketModule.isBinaryWire() ? "binary frame" : "msgPack") << std::endl;
 
     A.socketModule.closeConnection();
 
@@ -0,0 +1,219 @@
+/**
+ * @file 8_fleet_load_client.cpp
+ * @brief This file's goal is to measure how many handshakes an authenticator sustains. It simulates a fleet of
+ * drones, each with its own PUF, spread over several threads. Every drone enrols with 8_fleet_load_server, then
+ * the drones authenticate again and again, at a target rate or as fast as possible, for a given duration.
+ * The output is the throughput and the latency percentiles of the enrolments and of the authentications.
+ * Usage : ./8_fleet_load_client <ip> [drones = 200] [threads = cores] [handshakes/s = 0, unlimited] [seconds = 10]
+ * Built with TRACING, it writes the phases of every handshake to fleet_client_trace.json.
+ *
+ */
+
+#include <string>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <condition_variable>
+
+#include "../UAV.hpp"
+#include "../utils.hpp"
+#include "../SocketModule.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/// @brief Latencies and failures seen by one thread, merged at the end
+struct ThreadResult {
+    std::vector<double> enrolLatencies;     // Microseconds
+    std::vector<double> authLatencies;      // Microseconds
+    int enroled = 0;
+    long long authFailed = 0;
+};
+
+/// @brief Lets the threads start authenticating together, once every drone is enroled
+struct StartGate {
+    std::mutex lock;
+    std::condition_variable cv;
+    int waiting = 0;
+    bool open = false;
+    Clock::time_point start;
+};
+
+static double microseconds(Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+/// @brief Print the percentiles of a set of latencies
+static void printLatencies(const char *name, std::vector<double> &latencies) {
+    if (latencies.empty()) {
+        std::cout << name << " latency : no sample" << std::endl;
+        return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(p * latencies.size());
+        return latencies[std::min(rank, latencies.size() - 1)];
+    };
+    std::cout << name << " latency (us) : p50 " << percentile(0.50) << ", p90 " << percentile(0.90)
+              << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999)
+              << ", max " << latencies.back() << std::endl;
+}
+
+/// @brief Body of one load thread : enrol its drones, wait for the others, then authenticate them in turn.
+static void runDrones(const char *ip, int first, int count, double interval, double duration, StartGate &gate,
+                      int threads, ThreadResult &result) {
+    TRACE_ONLY({Tracer::setThreadName("drones " + std::to_string(first) + "-" + std::to_string(first + count - 1));});
+    std::vector<std::unique_ptr<UAV>> drones;
+    drones.reserve(count);
+
+    for (int i = first; i < first + count; i++) {
+        // Each UAV draws its own PUF salt
+        std::unique_ptr<UAV> drone(new UAV("D" + std::to_string(i)));
+        if (!drone->socketModule.initiateConnection(ip, 8080)) {
+            continue;
+        }
+        Clock::time_point begin = Clock::now();
+        if (drone->enrolment_client() != 0) {
+            drone->socketModule.closeConnection();
+            continue;
+        }
+        result.enrolLatencies.push_back(microseconds(Clock::now() - begin));
+        drones.push_back(std::move(drone));
+    }
+    result.enroled = static_cast<int>(drones.size());
+
+    Clock::time_point start;
+    {
+        std::unique_lock<std::mutex> guard(gate.lock);
+        gate.waiting++;
+        gate.cv.notify_all();
+        gate.cv.wait(guard, [&]() { return gate.open; });
+        start = gate.start;
+    }
+    if (drones.empty()) {
+        return;
+    }
+
+    // The threads share the rate, each one starts its handshakes at a fixed pace. The latency is taken
+    // from the time the handshake was due, so the time spent behind schedule when the server is
+    // saturated counts, instead of being hidden by starting late.
+    Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(interval * threads));
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration));
+    Clock::time_point due = start;
+    size_t next = 0;
+
+    while (!drones.empty()) {
+        if (interval > 0) {
+            if (due >= end) break;
+            std::this_thread::sleep_until(due);
+        } else {
+            due = Clock::now();
+            if (due >= end) break;
+        }
+
+        next %= drones.size();
+        int ret = drones[next]->autentication_client("GS");
+        if (ret == 0) {
+            result.authLatencies.push_back(microseconds(Clock::now() - due));
+            next++;
+        } else {
+            result.authFailed++;
+            if (ret < 0) {
+                // The connection is lost, the drone leaves the fleet
+                drones[next]->socketModule.closeConnection();
+                drones.erase(drones.begin() + next);
+            } else {
+                next++;
+            }
+        }
+        if (interval > 0) {
+            due += step;
+        }
+    }
+
+    for (std::unique_ptr<UAV> &drone : drones) {
+        drone->socketModule.closeConnection();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Error: No IP address provided. Please provide the IP as an argument." << std::endl;
+        return 1;  // Exit with an error code
+    }
+
+    const char* ip = argv[1];  // Read IP from command-line argument
+    int fleetSize = (argc > 2) ? std::stoi(argv[2]) : 200;
+    int threads = (argc > 3) ? std::stoi(argv[3]) : static_cast<int>(std::thread::hardware_concurrency());
+    double rate = (argc > 4) ? std::stod(argv[4]) : 0;
+    double duration = (argc > 5) ? std::stod(argv[5]) : 10;
+
+    if (threads <= 0) threads = 1;
+    if (threads > fleetSize) threads = fleetSize;
+    double interval = rate > 0 ? 1.0 / rate : 0;
+
+    std::cout << "Fleet of " << fleetSize << " drones on " << threads << " threads, ";
+    if (rate > 0) {
+        std::cout << "target " << rate << " handshakes/s";
+    } else {
+        std::cout << "unlimited rate";
+    }
+    std::cout << ", " << duration << " s" << std::endl;
+
+    // Warming up LibTomCrypt
+    warmup();
+
+    StartGate gate;
+    std::vector<ThreadResult> results(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    Clock::time_point enrolStart = Clock::now();
+    for (int t = 0; t < threads; t++) {
+        int first = fleetSize * t / threads;
+        int count = fleetSize * (t + 1) / threads - first;
+        workers.emplace_back(runDrones, ip, first, count, interval, duration, std::ref(gate), threads, std::ref(results[t]));
+    }
+
+    // Every drone is enroled before the authentications start
+    {
+        std::unique_lock<std::mutex> guard(gate.lock);
+        gate.cv.wait(guard, [&]() { return gate.waiting == threads; });
+        gate.start = Clock::now();
+        gate.open = true;
+        gate.cv.notify_all();
+    }
+    std::chrono::duration<double> enrolTime = gate.start - enrolStart;
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> authTime = Clock::now() - gate.start;
+
+    ThreadResult total;
+    for (ThreadResult &result : results) {
+        total.enroled += result.enroled;
+        total.authFailed += result.authFailed;
+        total.enrolLatencies.insert(total.enrolLatencies.end(), result.enrolLatencies.begin(), result.enrolLatencies.end());
+        total.authLatencies.insert(total.authLatencies.end(), result.authLatencies.begin(), result.authLatencies.end());
+    }
+
+    std::cout << total.enroled << "/" << fleetSize << " drones enroled in " << enrolTime.count() << " s ("
+              << total.enroled / enrolTime.count() << " enrolments/s)" << std::endl;
+    printLatencies("Enrolment", total.enrolLatencies);
+
+    std::cout << total.authLatencies.size() << " authentications in " << authTime.count() << " s ("
+              << total.authLatencies.size() / authTime.count() << " handshakes/s), "
+              << total.authFailed << " failed" << std::endl;
+    printLatencies("Authentication", total.authLatencies);
+    TRACE_ONLY({
+        if (Tracer::writeChromeTrace("fleet_client_trace.json") == 0) {
+            std::cout << "Trace written to fleet_client_trace.json" << std::endl;
+        }
+    });
+
+    return total.enroled == fleetSize && total.authFailed == 0 ? 0 : 1;
+}
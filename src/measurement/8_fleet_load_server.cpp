@@ -0,0 +1,117 @@
+/**
+ * @file 8_fleet_load_server.cpp
+ * @brief Authenticator side of the fleet load test. It serves every drone of 8_fleet_load_client from one
+ * thread, like the ground station of scenario 5, and prints the number of handshakes completed each second.
+ * Usage : ./8_fleet_load_server [expected drones] [epoll | io_uring]
+ * The io_uring backend needs a build with USE_IO_URING and Linux 6.0 or later, otherwise epoll is kept.
+ * Built with TRACING, it writes the phases of the handshakes to fleet_server_trace.json whenever the fleet leaves.
+ *
+ */
+
+#include <string>
+#include <memory>
+#include <chrono>
+
+#include "../UAV.hpp"
+#include "../utils.hpp"
+#include "../EpollServer.hpp"
+#include "../ProtocolSession.hpp"
+
+int main(int argc, char* argv[]) {
+    int expected = (argc > 1) ? std::stoi(argv[1]) : 0;
+
+    UAV GS("GS");
+    TRACE_ONLY({Tracer::setThreadName("GS");});
+    if (expected > 0) {
+        GS.reserveUAVs(expected);
+    }
+
+    // Warming up LibTomCrypt
+    warmup();
+
+    EpollServer server;
+    if (argc > 2 && std::string(argv[2]) == "io_uring") {
+        server.useIoUring();
+    }
+    if (!server.listenOn(8080)) {
+        return 1;
+    }
+    std::cout << "Serving the fleet with " << server.getBackend() << ".\n";
+
+    std::unordered_map<int, std::unique_ptr<ProtocolSession>> sessions;
+    long long succeeded = 0;
+    long long failed = 0;
+
+    server.onMessage([&](int fd, const ProtocolMessage &msg) {
+        auto it = sessions.find(fd);
+        if (it == sessions.end() || it->second->isDone()) {
+            std::unique_ptr<ProtocolSession> session = createResponderSession(GS, msg);
+            if (!session) {
+                std::cerr << "Error: unexpected message on fd " << fd << std::endl;
+                server.closeConnection(fd);
+                return;
+            }
+            sessions[fd] = std::move(session);
+            it = sessions.find(fd);
+        }
+
+        std::vector<ProtocolMessage> out;
+        it->second->onMessage(msg, out);
+        for (const ProtocolMessage &rsp : out) {
+            server.sendMsg(fd, rsp);
+        }
+
+        if (it->second->isDone()) {
+            if (it->second->getResult() == 0) {
+                succeeded++;
+            } else {
+                failed++;
+            }
+        }
+    });
+
+    server.onClose([&](int fd) {
+        auto it = sessions.find(fd);
+        if (it == sessions.end()) return;
+        if (!it->second->isDone()) {
+            failed++;
+        }
+        sessions.erase(it);
+    });
+
+    std::cout << "Waiting for drones on port 8080...\n";
+
+    // One line per second while handshakes are going on
+    auto lastReport = std::chrono::steady_clock::now();
+    long long lastSucceeded = 0;
+    long long lastFailed = 0;
+    while (true) {
+        if (server.pollOnce(100) < 0) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed = now - lastReport;
+        if (elapsed.count() < 1.0) {
+            continue;
+        }
+        if (succeeded != lastSucceeded || failed != lastFailed) {
+            std::cout << (succeeded - lastSucceeded) / elapsed.count() << " handshakes/s, "
+                      << failed - lastFailed << " failed, " << server.connectionCount() << " drones connected" << std::endl;
+        }
+        TRACE_ONLY({
+            static long long traced = 0;
+            if (server.connectionCount() == 0 && succeeded + failed != traced) {
+                traced = succeeded + failed;
+                if (Tracer::writeChromeTrace("fleet_server_trace.json") == 0) {
+                    std::cout << "Trace written to fleet_server_trace.json" << std::endl;
+                }
+            }
+        });
+        lastReport = now;
+        lastSucceeded = succeeded;
+        lastFailed = failed;
+    }
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file 9_loopback_protocol.cpp
+ * @brief This file's goal is to measure the CPU cost of the protocol alone. The client and the server UAVs live in
+ * this process and talk through a LoopbackTransport pair instead of TCP, so there is no kernel or network time
+ * in the results and a single binary is enough.
+ * In the "threads" mode, the blocking functions of each UAV run on their own thread. In the "interleaved" mode,
+ * one thread drives the ProtocolSessions of both UAVs in turn, which gives the same result at every run.
+ * Usage : ./9_loopback_protocol [rounds = 1000] [threads | interleaved]
+ * Built with TRACING, it writes the phases of the handshakes to loopback_trace.json.
+ *
+ */
+
+#include <string>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include "../UAV.hpp"
+#include "../utils.hpp"
+#include "../SocketModule.hpp"
+#include "../Transport.hpp"
+#include "../ProtocolSession.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/// @brief Send the messages of one UAV through its transport and hand them to the session of the other one
+static void deliver(std::vector<ProtocolMessage> &out, SocketModule &from, SocketModule &to,
+                    ProtocolSession &receiver, std::vector<ProtocolMessage> &replies) {
+    for (const ProtocolMessage &msg : out) {
+        from.sendMsg(msg);
+    }
+    size_t count = out.size();
+    out.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        ProtocolMessage in;
+        to.receiveMsg(in);
+        receiver.onMessage(in, replies);
+    }
+}
+
+/// @brief Run a client and a server session against each other on the calling thread
+static int interleave(ProtocolSession &client, ProtocolSession &server, SocketModule &clientSocket, SocketModule &serverSocket) {
+    std::vector<ProtocolMessage> toServer;
+    std::vector<ProtocolMessage> toClient;
+    client.start(toServer);
+    while (!toServer.empty()) {
+        deliver(toServer, clientSocket, serverSocket, server, toClient);
+        deliver(toClient, serverSocket, clientSocket, client, toServer);
+    }
+    return client.getResult() == 0 && server.getResult() == 0 ? 0 : 1;
+}
+
+/// @brief Print the mean and the median of the durations of the rounds
+static void printDurations(const char *name, std::vector<double> &durations) {
+    if (durations.empty()) return;
+    double total = 0;
+    for (double d : durations) total += d;
+    std::sort(durations.begin(), durations.end());
+    std::cout << name << " : " << durations.size() << " rounds, mean " << total / durations.size()
+              << " ns, median " << durations[durations.size() / 2] << " ns, min " << durations.front() << " ns" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = (argc > 1) ? std::stoi(argv[1]) : 1000;
+    bool interleaved = (argc > 2) && std::string(argv[2]) == "interleaved";
+
+    UAV A("A");
+    UAV B("B");
+
+    std::unique_ptr<Transport> clientEnd;
+    std::unique_ptr<Transport> serverEnd;
+    LoopbackTransport::createPair(clientEnd, serverEnd);
+    A.socketModule.useTransport(std::move(clientEnd));
+    B.socketModule.useTransport(std::move(serverEnd));
+
+    // Warming up LibTomCrypt
+    warmup();
+    TRACE_ONLY({Tracer::setThreadName(interleaved ? "A and B" : "A");});
+
+    std::vector<double> enrolment;
+    std::vector<double> authentication;
+    authentication.reserve(rounds);
+    int failed = 0;
+
+    if (interleaved) {
+        Clock::time_point start = Clock::now();
+        EnrolmentClientSession enrolClient(A);
+        EnrolmentServerSession enrolServer(B);
+        failed += interleave(enrolClient, enrolServer, A.socketModule, B.socketModule);
+        enrolment.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+
+        for (int i = 0; i < rounds; i++) {
+            start = Clock::now();
+            AuthenticationClientSession client(A, "B");
+            AuthenticationServerSession server(B);
+            failed += interleave(client, server, A.socketModule, B.socketModule);
+            authentication.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+    } else {
+        // B answers on its own thread, the client side is timed
+        std::thread server([&B, rounds]() {
+            TRACE_ONLY({Tracer::setThreadName("B");});
+            if (B.enrolment_server() != 0) return;
+            for (int i = 0; i < rounds; i++) {
+                if (B.autentication_server() != 0) return;
+            }
+        });
+
+        Clock::time_point start = Clock::now();
+        failed += A.enrolment_client() != 0;
+        enrolment.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+
+        for (int i = 0; i < rounds && failed == 0; i++) {
+            start = Clock::now();
+            failed += A.autentication_client("B") != 0;
+            authentication.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+        server.join();
+    }
+
+    std::cout << "Mode : " << (interleaved ? "interleaved" : "threads") << std::endl;
+    printDurations("Enrolment", enrolment);
+    printDurations("Authentication", authentication);
+    MEASURE_ONLY({LatencyHistogram::printAll(std::cout, "cycles");});
+    TRACE_ONLY({
+        if (Tracer::writeChromeTrace("loopback_trace.json") == 0) {
+            std::cout << "Trace written to loopback_trace.json" << std::endl;
+        }
+    });
+    if (failed > 0) {
+        std::cout << "There was a problem : " << failed << " failed handshakes" << std::endl;
+        return 1;
+    }
+
+    A.socketModule.closeConnection();
+    B.socketModule.closeConnection();
+    return 0;
+}
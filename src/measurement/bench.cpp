@@ -0,0 +1,406 @@
+/**
+ * @file bench.cpp
+ * @brief Single driver for the micro and protocol benchmarks. Every benchmark is registered in the BENCHMARKS
+ * table below ; the driver runs the selected ones with the same warmup and repetition counts and prints the
+ * min, median, p99, mean and standard deviation of each, as a table, CSV or JSON, so the results of several
+ * builds or boards can be compared without parsing printouts.
+ * The UAVs of the protocol benchmarks live in this process and talk through a LoopbackTransport pair.
+ *
+ * Usage : ./bench [--reps N] [--warmup N] [--filter text] [--format table|csv|json] [--output file] [--list]
+ * A warmup of 0 also skips the LibTomCrypt warmup, so the first repetition shows the cold start.
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include "../UAV.hpp"
+#include "../utils.hpp"
+#include "../sha256.hpp"
+#include "../TranscriptHash.hpp"
+#include "../WireFormat.hpp"
+#include "../Transport.hpp"
+#include "../ProtocolSession.hpp"
+#include "../CycleCounter.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+/// @brief State shared by the benchmarks : A and B enroled with each other, C holding the credentials
+/// of A as if it got them from the base station. The module of A is linked to B, so C talks to AC,
+/// a second UAV with the PUF of A.
+struct BenchContext {
+    UAV A;
+    UAV B;
+    UAV C;
+    UAV AC;
+    unsigned char x[PUF_SIZE];
+    unsigned char y[PUF_SIZE];
+    unsigned char z[PUF_SIZE];
+    unsigned char batch[8][PUF_SIZE];
+    ProtocolMessage message;        // Second message of an authentication
+    msgpack::sbuffer packed;
+    WireFrame frame;
+    CycleCounter counter;
+    long long ticks;                // Last counter value, kept so the reads are not optimised out
+
+    explicit BenchContext(unsigned char *saltA) : A("A", saltA), B("B"), C("C"), AC("A", saltA), ticks(0) {}
+};
+
+/// @brief Run a client and a server session against each other through the loopback transports of their UAVs
+static int interleave(ProtocolSession &client, ProtocolSession &server, SocketModule &clientSocket, SocketModule &serverSocket) {
+    std::vector<ProtocolMessage> toServer;
+    std::vector<ProtocolMessage> toClient;
+    client.start(toServer);
+    while (!toServer.empty()) {
+        for (const ProtocolMessage &msg : toServer) clientSocket.sendMsg(msg);
+        for (size_t i = 0; i < toServer.size(); i++) {
+            ProtocolMessage in;
+            serverSocket.receiveMsg(in);
+            server.onMessage(in, toClient);
+        }
+        toServer.clear();
+
+        for (const ProtocolMessage &msg : toClient) serverSocket.sendMsg(msg);
+        for (size_t i = 0; i < toClient.size(); i++) {
+            ProtocolMessage in;
+            clientSocket.receiveMsg(in);
+            client.onMessage(in, toServer);
+        }
+        toClient.clear();
+    }
+    return client.getResult() == 0 && server.getResult() == 0 ? 0 : 1;
+}
+
+static void benchPuf(BenchContext &ctx) {
+    ctx.A.callPUF(ctx.x, ctx.y);
+}
+
+static void benchPufBatch(BenchContext &ctx) {
+    unsigned char out[8][PUF_SIZE];
+    ctx.A.callPUFBatch(ctx.batch, 8, out);
+}
+
+static void benchRandom(BenchContext &ctx) {
+    generate_random_bytes(ctx.z, PUF_SIZE);
+}
+
+// hash1 = H(CA, NB, RA, NA)
+static void benchHash4(BenchContext &ctx) {
+    TranscriptHash().add(ctx.x).add(ctx.y).add(ctx.z).add(ctx.x).finish(ctx.z);
+}
+
+// hash3 = H(RAp, NB, NA)
+static void benchHash3(BenchContext &ctx) {
+    TranscriptHash().add(ctx.x).add(ctx.y).add(ctx.z).finish(ctx.z);
+}
+
+// Supplementary hash1 = H(id, CA, NC, RA, NA)
+static void benchHashId(BenchContext &ctx) {
+    TranscriptHash().add(ctx.A.getId()).add(ctx.x).add(ctx.y).add(ctx.z).add(ctx.x).finish(ctx.z);
+}
+
+static void benchHkdf(BenchContext &ctx) {
+    deriveKeyUsingHKDF(ctx.x, ctx.y, ctx.z, PUF_SIZE, ctx.z);
+}
+
+static void benchPack(BenchContext &ctx) {
+    ctx.packed.clear();
+    msgpack::pack(ctx.packed, ctx.message);
+}
+
+// Same steps as SocketModule::receiveMsg
+static void benchUnpack(BenchContext &ctx) {
+    msgpack::unpacker pac;
+    pac.reserve_buffer(ctx.packed.size());
+    memcpy(pac.buffer(), ctx.packed.data(), ctx.packed.size());
+    pac.buffer_consumed(ctx.packed.size());
+
+    msgpack::object_handle handle;
+    if (!pac.next(handle)) return;
+    msgpack::object obj = handle.get();
+    ProtocolMessage msg;
+    for (uint32_t i = 0; i < obj.via.map.size; ++i) {
+        const msgpack::object_kv& kv = obj.via.map.ptr[i];
+        std::string key;
+        std::string value;
+        kv.key.convert(key);
+        kv.val.convert(value);
+        msg.emplace(std::move(key), std::move(value));
+    }
+}
+
+static void benchWireEncode(BenchContext &ctx) {
+    wireFromMap(ctx.message, ctx.frame);
+}
+
+static void benchWireDecode(BenchContext &ctx) {
+    ProtocolMessage msg;
+    wireToMap(ctx.frame, msg);
+}
+
+// Cost of the instrumentation of the MEASURE_ONLY blocks
+static void benchCounterCycles(BenchContext &ctx) {
+    ctx.ticks += ctx.counter.getCycles();
+}
+
+static void benchCounterGroup(BenchContext &ctx) {
+    CounterSample sample;
+    ctx.counter.read(sample);
+    ctx.ticks += sample.value[COUNTER_TASK_CLOCK];
+}
+
+static void benchCounterTimestamp(BenchContext &ctx) {
+    ctx.ticks += CycleCounter::getTimestamp();
+}
+
+static void benchEnrolment(BenchContext &ctx) {
+    EnrolmentClientSession client(ctx.A);
+    EnrolmentServerSession server(ctx.B);
+    if (interleave(client, server, ctx.A.socketModule, ctx.B.socketModule) != 0) {
+        std::cerr << "Error: the enrolment failed." << std::endl;
+    }
+}
+
+static void benchEnrolmentPipelined(BenchContext &ctx) {
+    EnrolmentClientSession client(ctx.A);
+    EnrolmentServerSession server(ctx.B, true);
+    if (interleave(client, server, ctx.A.socketModule, ctx.B.socketModule) != 0) {
+        std::cerr << "Error: the pipelined enrolment failed." << std::endl;
+    }
+}
+
+static void benchAuthentication(BenchContext &ctx) {
+    AuthenticationClientSession client(ctx.A, "B");
+    AuthenticationServerSession server(ctx.B);
+    if (interleave(client, server, ctx.A.socketModule, ctx.B.socketModule) != 0) {
+        std::cerr << "Error: the authentication failed." << std::endl;
+    }
+}
+
+static void benchAuthenticationKey(BenchContext &ctx) {
+    AuthenticationClientSession client(ctx.A, "B", true);
+    AuthenticationServerSession server(ctx.B);
+    if (interleave(client, server, ctx.A.socketModule, ctx.B.socketModule) != 0) {
+        std::cerr << "Error: the authentication with key failed." << std::endl;
+    }
+}
+
+static void benchSupplementary(BenchContext &ctx) {
+    // A only runs it with UAVs it does not know yet
+    ctx.AC.removeUAV("C");
+    SupplementarySupSession client(ctx.C);
+    SupplementaryInitialSession server(ctx.AC);
+    if (interleave(client, server, ctx.C.socketModule, ctx.AC.socketModule) != 0) {
+        std::cerr << "Error: the supplementary authentication failed." << std::endl;
+    }
+}
+
+/// @brief A registered benchmark. Short operations run batch times per sample, the sample is divided by batch.
+struct Benchmark {
+    const char *name;
+    void (*run)(BenchContext &ctx);
+    int batch;
+};
+
+static const Benchmark BENCHMARKS[] = {
+    {"puf",                     benchPuf,               16},
+    {"puf_batch8",              benchPufBatch,          4},
+    {"random_32",               benchRandom,            16},
+    {"hash_4_fields",           benchHash4,             16},
+    {"hash_3_fields",           benchHash3,             16},
+    {"hash_id_4_fields",        benchHashId,            16},
+    {"hkdf",                    benchHkdf,              4},
+    {"msgpack_pack",            benchPack,              16},
+    {"msgpack_unpack",          benchUnpack,            16},
+    {"wire_encode",             benchWireEncode,        16},
+    {"wire_decode",             benchWireDecode,        16},
+    {"counter_cycles",          benchCounterCycles,     16},
+    {"counter_group",           benchCounterGroup,      16},
+    {"counter_timestamp",       benchCounterTimestamp,  16},
+    {"enrolment",               benchEnrolment,         1},
+    {"enrolment_pipelined",     benchEnrolmentPipelined, 1},
+    {"authentication",          benchAuthentication,    1},
+    {"authentication_key",      benchAuthenticationKey, 1},
+    {"supplementary",           benchSupplementary,     1},
+};
+
+/// @brief Statistics of the samples of one benchmark, in nanoseconds per operation
+struct BenchResult {
+    std::string name;
+    size_t reps;
+    int batch;
+    double min;
+    double median;
+    double p99;
+    double mean;
+    double stddev;
+};
+
+static BenchResult runBenchmark(const Benchmark &bench, BenchContext &ctx, int warmupReps, int reps) {
+    for (int i = 0; i < warmupReps; i++) {
+        for (int j = 0; j < bench.batch; j++) bench.run(ctx);
+    }
+
+    std::vector<double> samples;
+    samples.reserve(reps);
+    for (int i = 0; i < reps; i++) {
+        Clock::time_point start = Clock::now();
+        for (int j = 0; j < bench.batch; j++) bench.run(ctx);
+        Clock::time_point end = Clock::now();
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count() / bench.batch);
+    }
+
+    BenchResult result;
+    result.name = bench.name;
+    result.reps = samples.size();
+    result.batch = bench.batch;
+
+    double sum = 0;
+    for (double s : samples) sum += s;
+    result.mean = sum / samples.size();
+    double var = 0;
+    for (double s : samples) var += (s - result.mean) * (s - result.mean);
+    result.stddev = samples.size() > 1 ? std::sqrt(var / (samples.size() - 1)) : 0;
+
+    std::sort(samples.begin(), samples.end());
+    result.min = samples.front();
+    result.median = samples[samples.size() / 2];
+    result.p99 = samples[std::min(samples.size() - 1, static_cast<size_t>(0.99 * samples.size()))];
+    return result;
+}
+
+static void printTable(std::ostream &out, const std::vector<BenchResult> &results) {
+    out << "benchmark                  reps      min(ns)   median(ns)      p99(ns)     mean(ns)   stddev(ns)" << std::endl;
+    for (const BenchResult &r : results) {
+        char line[160];
+        snprintf(line, sizeof(line), "%-24s %6zu %12.1f %12.1f %12.1f %12.1f %12.1f",
+                 r.name.c_str(), r.reps, r.min, r.median, r.p99, r.mean, r.stddev);
+        out << line << std::endl;
+    }
+}
+
+static void printCsv(std::ostream &out, const std::vector<BenchResult> &results) {
+    out << "benchmark,reps,batch,min_ns,median_ns,p99_ns,mean_ns,stddev_ns" << std::endl;
+    for (const BenchResult &r : results) {
+        out << r.name << "," << r.reps << "," << r.batch << "," << r.min << "," << r.median << ","
+            << r.p99 << "," << r.mean << "," << r.stddev << std::endl;
+    }
+}
+
+static void printJson(std::ostream &out, const std::vector<BenchResult> &results, const char *backend, const char *counter,
+                      int warmupReps, int reps) {
+    out << "{\n  \"backend\": \"" << backend << "\",\n  \"counter\": \"" << counter << "\",\n  \"warmup\": " << warmupReps << ",\n  \"reps\": " << reps
+        << ",\n  \"unit\": \"ns\",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"reps\": " << r.reps << ", \"batch\": " << r.batch
+            << ", \"min\": " << r.min << ", \"median\": " << r.median << ", \"p99\": " << r.p99
+            << ", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int reps = 1000;
+    int warmupReps = 10;
+    std::string filter;
+    std::string format = "table";
+    std::string output;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--reps" && hasValue) {
+            reps = std::stoi(argv[++i]);
+        } else if (arg == "--warmup" && hasValue) {
+            warmupReps = std::stoi(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        } else if (arg == "--format" && hasValue) {
+            format = argv[++i];
+        } else if (arg == "--output" && hasValue) {
+            output = argv[++i];
+        } else if (arg == "--list") {
+            for (const Benchmark &bench : BENCHMARKS) std::cout << bench.name << std::endl;
+            return 0;
+        } else {
+            std::cerr << "Usage : " << argv[0] << " [--reps N] [--warmup N] [--filter text] [--format table|csv|json] [--output file] [--list]" << std::endl;
+            return 1;
+        }
+    }
+    if (reps <= 0 || (format != "table" && format != "csv" && format != "json")) {
+        std::cerr << "Error: invalid repetitions or format." << std::endl;
+        return 1;
+    }
+
+    // Warming up LibTomCrypt
+    if (warmupReps > 0) {
+        warmup();
+    }
+
+    unsigned char saltA[PUF_SIZE];
+    generate_random_bytes(saltA);
+    BenchContext ctx(saltA);
+    generate_random_bytes(ctx.x);
+    generate_random_bytes(ctx.y);
+    generate_random_bytes(ctx.z);
+    generate_random_bytes(ctx.batch[0], sizeof(ctx.batch));
+
+    std::unique_ptr<Transport> first;
+    std::unique_ptr<Transport> second;
+    LoopbackTransport::createPair(first, second);
+    ctx.A.socketModule.useTransport(std::move(first));
+    ctx.B.socketModule.useTransport(std::move(second));
+    LoopbackTransport::createPair(first, second);
+    ctx.C.socketModule.useTransport(std::move(first));
+    ctx.AC.socketModule.useTransport(std::move(second));
+
+    // A and B enrol once for the authentications, C gets the credentials of A
+    benchEnrolment(ctx);
+    {
+        unsigned char CA[PUF_SIZE], RA[PUF_SIZE], xLock[PUF_SIZE], lock[PUF_SIZE], secret[PUF_SIZE];
+        generate_random_bytes(CA);
+        ctx.A.callPUF(CA, RA);
+        generate_random_bytes(xLock);
+        ctx.C.callPUF(xLock, lock);
+        xor_buffers(RA, lock, PUF_SIZE, secret);
+        ctx.C.addUAV("A", nullptr, CA, nullptr, xLock, secret);
+    }
+
+    ctx.message.emplace("id", ctx.A.getId());
+    ctx.message.emplace("M2", std::string(reinterpret_cast<const char*>(ctx.x), PUF_SIZE));
+    ctx.message.emplace("hash2", std::string(reinterpret_cast<const char*>(ctx.y), PUF_SIZE));
+    msgpack::pack(ctx.packed, ctx.message);
+    wireFromMap(ctx.message, ctx.frame);
+
+    const char *backend = sha256_select_backend();
+
+    std::vector<BenchResult> results;
+    for (const Benchmark &bench : BENCHMARKS) {
+        if (!filter.empty() && std::string(bench.name).find(filter) == std::string::npos) continue;
+        results.push_back(runBenchmark(bench, ctx, warmupReps, reps));
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output.c_str());
+        if (!file) {
+            std::cerr << "Error: cannot write " << output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = output.empty() ? std::cout : file;
+
+    if (format == "json") {
+        printJson(out, results, backend, ctx.counter.getSource(), warmupReps, reps);
+    } else if (format == "csv") {
+        printCsv(out, results);
+    } else {
+        printTable(out, results);
+    }
+    return 0;
+}
@@ -7,16 +7,17 @@
  */
 
 #include "puf.hpp"
+#include "sha256.hpp"
 
 /// @brief This function represent the coputation of the PUF. SHA256 is a one-way function used to simulate a PUF behaviour.
 void sha256_raw(const unsigned char* data, size_t len, const unsigned char * salt, size_t saltSize, unsigned char* output) {
     hash_state md;
-    sha256_init(&md);
+    sha256_accel_init(&md);
     if (salt != NULL && saltSize > 0) {
-        sha256_process(&md, salt, saltSize);
+        sha256_accel_process(&md, salt, saltSize);
     }
-    sha256_process(&md, data, len);
-    sha256_done(&md, output);
+    sha256_accel_process(&md, data, len);
+    sha256_accel_done(&md, output);
 }
 
 /// @brief Constructor
@@ -24,18 +25,27 @@ puf::puf() : salt{} {
     generate_random_bytes(const_cast<unsigned char*>(salt), PUF_SIZE);
 }
 
-puf::puf(unsigned char * salt) : salt{} { 
+puf::puf(const unsigned char * salt) : salt{} { 
     memcpy(this->salt, salt, PUF_SIZE);
 }
 
-/// @brief Initiate the PUF computation.
+/// @brief Initiate the PUF computation. A challenge of PUF_SIZE bytes takes the fixed size path.
 /// @param input 
 /// @param size 
 /// @param output 
 void puf::process(const unsigned char * input, size_t size, unsigned char * output) const{
+    if (size == PUF_SIZE) {
+        sha256_puf(this->salt, input, output);
+        return;
+    }
     sha256_raw(input, size, this->salt, sizeof(this->salt), output);
 }
 
-
-
-
+/// @brief Evaluate the PUF on n challenges of PUF_SIZE bytes at once, several challenges per SIMD instruction.
+/// Gives the same responses as calling process() on each challenge.
+/// @param input 
+/// @param n 
+/// @param output 
+void puf::processBatch(const uint8_t (*input)[PUF_SIZE], size_t n, uint8_t (*output)[PUF_SIZE]) const{
+    sha256_puf_batch(this->salt, input, n, output);
+}
@@ -20,9 +20,10 @@ private:
     unsigned char salt[PUF_SIZE];
 public:
     puf();
-    puf(unsigned char * salt);
+    puf(const unsigned char * salt);
 
     void process(const unsigned char * input, size_t size, unsigned char * output) const;
+    void processBatch(const uint8_t (*input)[PUF_SIZE], size_t n, uint8_t (*output)[PUF_SIZE]) const;
     
     // void printSalt() const{
     //     print_hex(salt,PUF_SIZE);
@@ -35,8 +35,8 @@ int main(){
     // BS sends those numbers to the PUF to create a list of challenges
     // In a message that will be sent to the UAV to get a list of responses
     unsigned char LC[CHALLENGE_SIZE][PUF_SIZE];
+    BSpuf.processBatch(Lx, CHALLENGE_SIZE, LC);
     for (int i = 0; i < CHALLENGE_SIZE; i++){
-        BSpuf.process(Lx[i], PUF_SIZE, LC[i]);
         std::cout << "LC[" << i << "]: "; print_hex(LC[i], PUF_SIZE);
     }
 
@@ -61,6 +61,7 @@ int main(){
     }
 
     extractValueFromMap(msg,"data",LR[0],CHALLENGE_SIZE*PUF_SIZE);
+    msg.clear();
 
     // Pre-enrolment done. Close connection.
     sm.closeConnection();
@@ -33,7 +33,7 @@ int main(int argc, char* argv[]) {
     C.socketModule.initiateConnection(ipBS, 8080);
 
     // A's credential retrieval
-    int ret = C.preEnrolmentRetrival();
+    int ret = C.preEnrolmentRetrival(idA);
     if (ret == 1){
         return ret;
     }
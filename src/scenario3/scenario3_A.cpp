@@ -38,7 +38,7 @@ int main(int argc, char* argv[]) {
 
     // This one should partially fail bafore the end, triggering the 
     // usage of CAOld in the next auth.
-    ret = A.failed_autentication_client();
+    ret = A.failed_autentication_client(idB);
     std::cout << "The autentication failed because of a timeout.\n";
 
     // Expected output is a fail
@@ -48,7 +48,7 @@ int main(int argc, char* argv[]) {
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     A.socketModule.initiateConnection(ip,8080);
 
-    ret = A.autentication_client();
+    ret = A.autentication_client(idB);
     if (ret != 0){
         return ret;
     }    
@@ -0,0 +1,119 @@
+#include <string>
+#include <memory>
+
+#include "../UAV.hpp"
+#include "../utils.hpp"
+#include "../EpollServer.hpp"
+#include "../ProtocolSession.hpp"
+#include "../SessionMux.hpp"
+
+std::string idGS = "GS";
+
+int main(int argc, char* argv[]){
+
+    // Creation of the ground station. Given a file, it keeps the drones enroled in a previous run.
+    // --io-uring serves the swarm with io_uring rather than epoll.
+
+    std::string storePath;
+    bool ioUring = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--io-uring") ioUring = true;
+        else storePath = argv[i];
+    }
+
+    std::unique_ptr<UAV> station(!storePath.empty() ? new UAV(idGS, storePath) : new UAV(idGS));
+    UAV &GS = *station;
+
+    std::cout << "The ground station id is : " << GS.getId() << ".\n";
+
+    EpollServer server;
+    if (ioUring) {
+        server.useIoUring();
+    }
+    if (!server.listenOn(8080)) {
+        return 1;
+    }
+
+    // One protocol session per connected drone, all driven from this thread. A relay carrying many drones
+    // over one connection tags their messages with a session id, they go through a SessionMux instead.
+    std::unordered_map<int, std::unique_ptr<ProtocolSession>> sessions;
+    std::unordered_map<int, std::unique_ptr<SessionMux>> muxes;
+    int succeeded = 0;
+    int failed = 0;
+
+    auto report = [&](ProtocolSession &session) {
+        if (session.getResult() == 0) {
+            succeeded++;
+        } else {
+            failed++;
+        }
+        std::cout << "Session with " << session.getPeerId() << " ended with " << session.getResult()
+                  << " (" << succeeded << " succeeded, " << failed << " failed).\n";
+    };
+
+    server.onMessage([&](int fd, const ProtocolMessage &msg) {
+        if (SessionMux::isMuxed(msg)) {
+            std::unique_ptr<SessionMux> &mux = muxes[fd];
+            if (!mux) {
+                mux.reset(new SessionMux(&GS));
+                mux->onDone([&](const std::string &, ProtocolSession &session) { report(session); });
+            }
+            std::vector<ProtocolMessage> out;
+            if (!mux->onMessage(msg, out)) {
+                server.closeConnection(fd);
+                return;
+            }
+            for (const ProtocolMessage &rsp : out) {
+                server.sendMsg(fd, rsp);
+            }
+            return;
+        }
+
+        auto it = sessions.find(fd);
+        if (it == sessions.end() || it->second->isDone()) {
+            // The first message of a handshake tells which protocol the drone runs
+            std::unique_ptr<ProtocolSession> session = createResponderSession(GS, msg);
+            if (!session) {
+                std::cerr << "Error: unexpected message on fd " << fd << std::endl;
+                server.closeConnection(fd);
+                return;
+            }
+            sessions[fd] = std::move(session);
+            it = sessions.find(fd);
+        }
+
+        std::vector<ProtocolMessage> out;
+        it->second->onMessage(msg, out);
+        for (const ProtocolMessage &rsp : out) {
+            server.sendMsg(fd, rsp);
+        }
+
+        if (it->second->isDone()) {
+            report(*it->second);
+        }
+    });
+
+    server.onClose([&](int fd) {
+        auto muxIt = muxes.find(fd);
+        if (muxIt != muxes.end()) {
+            // The sessions still open are aborted and reported as failed
+            std::vector<ProtocolMessage> out;
+            muxIt->second->onTimeout(out);
+            muxes.erase(muxIt);
+        }
+
+        auto it = sessions.find(fd);
+        if (it == sessions.end()) return;
+        if (!it->second->isDone()) {
+            std::vector<ProtocolMessage> out;
+            it->second->onTimeout(out);
+            failed++;
+        }
+        sessions.erase(it);
+    });
+
+    std::cout << "Waiting for drones on port 8080...\n";
+    server.run();
+
+    return 0;
+}
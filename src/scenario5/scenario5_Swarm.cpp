@@ -0,0 +1,111 @@
+#include <string>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "../UAV.hpp"
+#include "../utils.hpp"
+#include "../SocketModule.hpp"
+#include "../SessionMux.hpp"
+
+/**
+ * @brief Run the whole swarm through one relay connection : the enrolments of every drone travel together,
+ * then their authentications, multiplexed by a SessionMux.
+ *
+ * @param ip
+ * @param swarmSize
+ * @return The number of drones authenticated
+ */
+static int runRelay(const char* ip, int swarmSize) {
+    SocketModule relay;
+    if (!relay.initiateConnection(ip, 8080)) {
+        return 0;
+    }
+
+    std::vector<std::unique_ptr<UAV>> drones;
+    drones.reserve(swarmSize);
+    for (int i = 0; i < swarmSize; i++) {
+        drones.emplace_back(new UAV("A" + std::to_string(i)));
+    }
+
+    int succeeded = 0;
+    SessionMux mux;
+    mux.onDone([&succeeded](const std::string &, ProtocolSession &session) {
+        if (session.getResult() == 0) succeeded++;
+    });
+
+    std::vector<ProtocolMessage> out;
+    for (std::unique_ptr<UAV> &drone : drones) {
+        mux.open(std::unique_ptr<ProtocolSession>(new EnrolmentClientSession(*drone)), out);
+    }
+    runMux(mux, relay, out);
+    std::cout << succeeded << "/" << swarmSize << " drones enroled through the relay" << std::endl;
+
+    succeeded = 0;
+    for (std::unique_ptr<UAV> &drone : drones) {
+        mux.open(std::unique_ptr<ProtocolSession>(new AuthenticationClientSession(*drone, "GS")), out);
+    }
+    runMux(mux, relay, out);
+
+    relay.closeConnection();
+    return succeeded;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Error: No IP address provided. Please provide the IP as an argument." << std::endl;
+        return 1;  // Exit with an error code
+    }
+
+    const char* ip = argv[1];  // Read IP from command-line argument
+    int swarmSize = (argc > 2) ? std::stoi(argv[2]) : 200;
+    bool relay = (argc > 3) && std::string(argv[3]) == "--mux";
+
+    std::cout << "Using IP: " << ip << std::endl;
+    std::cout << "Swarm size: " << swarmSize << std::endl;
+
+    if (relay) {
+        auto relay_start = std::chrono::steady_clock::now();
+        int authenticated = runRelay(ip, swarmSize);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - relay_start;
+        std::cout << authenticated << "/" << swarmSize << " drones authenticated through one connection in "
+                  << elapsed.count() << " s" << std::endl;
+        return authenticated == swarmSize ? 0 : 1;
+    }
+
+    std::atomic<int> succeeded(0);
+    std::vector<std::thread> drones;
+    drones.reserve(swarmSize);
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    // Every drone enrols then authenticates with the ground station at the same time
+    for (int i = 0; i < swarmSize; i++) {
+        drones.emplace_back([i, ip, &succeeded]() {
+            UAV drone("A" + std::to_string(i));
+
+            if (!drone.socketModule.initiateConnection(ip, 8080)) {
+                return;
+            }
+            if (drone.enrolment_client() != 0) {
+                return;
+            }
+            if (drone.autentication_client("GS") != 0) {
+                return;
+            }
+            drone.socketModule.closeConnection();
+            succeeded++;
+        });
+    }
+
+    for (std::thread &drone : drones) {
+        drone.join();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::cout << succeeded << "/" << swarmSize << " drones authenticated in " << elapsed.count() << " s" << std::endl;
+
+    return succeeded == swarmSize ? 0 : 1;
+}
@@ -0,0 +1,469 @@
+/**
+ * @file sha256.cpp
+ * @brief SHA-256 backends implementation
+ *
+ * This file holds the SHA-256 kernels. The hardware backends use the SHA instructions of the CPU.
+ * The multi-buffer compression function is written once over a generic word type : uint32_t for the
+ * scalar path and GCC vector types for the SIMD paths, which the compiler lowers to SSE2, AVX2 or NEON.
+ *
+ */
+
+#include "sha256.hpp"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_X86
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define SHA256_ARMV8
+#endif
+
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+#ifdef SHA256_X86
+typedef uint32_t u32x8 __attribute__((vector_size(32)));
+#endif
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t H256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// salt || input is exactly one block, the second block only holds the padding and the 512 bits length.
+// Its message schedule never changes : W[t] + K256[t] of that block, precomputed.
+static const uint32_t PADDING_WK[64] = {
+    0xc28a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf374,
+    0x649b69c1, 0xf0fe4786, 0x0fe1edc6, 0x240cf254, 0x4fe9346f, 0x6cc984be, 0x61b9411e, 0x16f988fa,
+    0xf2c65152, 0xa88e5a6d, 0xb019fc65, 0xb9d99ec7, 0x9a1231c3, 0xe70eeaa0, 0xfdb1232b, 0xc7353eb0,
+    0x3069bad5, 0xcb976d5f, 0x5a0f118f, 0xdc1eeefd, 0x0a35b689, 0xde0b7a04, 0x58f4ca9d, 0xe15d5b16,
+    0x007f3e86, 0x37088980, 0xa507ea32, 0x6fab9537, 0x17406110, 0x0d8cd6f1, 0xcdaa3b6d, 0xc0bbbe37,
+    0x83613bda, 0xdb48a363, 0x0b02e931, 0x6fd15ca7, 0x521afaca, 0x31338431, 0x6ed41a95, 0x6d437890,
+    0xc39c91f2, 0x9eccabbd, 0xb5c9a0e6, 0x532fb63c, 0xd2c741c6, 0x07237ea3, 0xa4954b68, 0x4c191d76
+};
+
+static const unsigned char PADDING_BYTES[64] = {
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00
+};
+
+/// @brief Compress a number of consecutive 64 bytes blocks into the state
+typedef void (*CompressBlocks)(uint32_t * state, const unsigned char * data, size_t blocks);
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static inline uint32_t load_be32(const unsigned char * p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+         | (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+static inline void store_be32(unsigned char * p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+#ifdef SHA256_X86
+/// @brief SHA-NI compression. The state is kept as ABEF / CDGH as required by sha256rnds2.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void compress_shani(uint32_t * state, const unsigned char * data, size_t blocks) {
+    const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+    __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                 // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);           // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);        // CDGH
+
+    while (blocks--) {
+        const __m128i abefSave = state0;
+        const __m128i cdghSave = state1;
+        __m128i W[4];
+
+        for (int i = 0; i < 16; i++) {
+            if (i < 4) {
+                W[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), MASK);
+            } else {
+                __m128i w = _mm_sha256msg1_epu32(W[i & 3], W[(i + 1) & 3]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(W[(i + 3) & 3], W[(i + 2) & 3], 4));
+                W[i & 3] = _mm_sha256msg2_epu32(w, W[(i + 3) & 3]);
+            }
+            __m128i msg = _mm_add_epi32(W[i & 3], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&K256[4 * i])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+        data += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);              // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);           // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);        // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);           // ABEF
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+static bool hasShaNi() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    bool sse41 = (ecx & bit_SSE4_1) != 0;
+    bool ssse3 = (ecx & bit_SSSE3) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return sse41 && ssse3 && (ebx & bit_SHA) != 0;
+}
+#endif
+
+#ifdef SHA256_ARMV8
+/// @brief ARMv8 crypto extension compression.
+__attribute__((target("+crypto")))
+static void compress_armv8(uint32_t * state, const unsigned char * data, size_t blocks) {
+    uint32x4_t state0 = vld1q_u32(&state[0]);   // ABCD
+    uint32x4_t state1 = vld1q_u32(&state[4]);   // EFGH
+
+    while (blocks--) {
+        const uint32x4_t abcdSave = state0;
+        const uint32x4_t efghSave = state1;
+        uint32x4_t W[4];
+
+        for (int i = 0; i < 16; i++) {
+            if (i < 4) {
+                W[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+            } else {
+                W[i & 3] = vsha256su1q_u32(vsha256su0q_u32(W[i & 3], W[(i + 1) & 3]), W[(i + 2) & 3], W[(i + 3) & 3]);
+            }
+            uint32x4_t msg = vaddq_u32(W[i & 3], vld1q_u32(&K256[4 * i]));
+            uint32x4_t abcd = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, abcd, msg);
+        }
+
+        state0 = vaddq_u32(state0, abcdSave);
+        state1 = vaddq_u32(state1, efghSave);
+        data += 64;
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+
+static bool hasArmv8Sha2() {
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+#endif
+
+/// @brief The selected backend. compress is nullptr when LibTomCrypt is used.
+struct Sha256Backend {
+    const char * name;
+    CompressBlocks compress;
+    struct ltc_hash_descriptor desc;
+    int hashIndex;
+};
+
+static Sha256Backend detectBackend() {
+    Sha256Backend backend;
+    backend.name = "libtomcrypt";
+    backend.compress = nullptr;
+#ifdef SHA256_X86
+    if (hasShaNi()) {
+        backend.name = "sha-ni";
+        backend.compress = compress_shani;
+    }
+#endif
+#ifdef SHA256_ARMV8
+    if (hasArmv8Sha2()) {
+        backend.name = "armv8-sha2";
+        backend.compress = compress_armv8;
+    }
+#endif
+
+    // Same name, size and OID as sha256_desc : HMAC, HKDF and the PUF all end up on the selected backend
+    backend.desc = sha256_desc;
+    if (backend.compress != nullptr) {
+        backend.desc.init = sha256_accel_init;
+        backend.desc.process = sha256_accel_process;
+        backend.desc.done = sha256_accel_done;
+    }
+    backend.hashIndex = register_hash(&backend.desc);
+    return backend;
+}
+
+/// @brief Selected once, thread-safe since C++11
+static const Sha256Backend& backend() {
+    static const Sha256Backend selected = detectBackend();
+    return selected;
+}
+
+const char * sha256_select_backend() {
+    return backend().name;
+}
+
+int sha256_hash_index() {
+    return backend().hashIndex;
+}
+
+int sha256_accel_init(hash_state * md) {
+    return sha256_init(md);
+}
+
+/// @brief Same buffering as the LibTomCrypt sha256_process, with the compression of the selected backend.
+int sha256_accel_process(hash_state * md, const unsigned char * in, unsigned long inlen) {
+    CompressBlocks compress = backend().compress;
+    if (compress == nullptr) {
+        return sha256_process(md, in, inlen);
+    }
+    if (md->sha256.curlen >= sizeof(md->sha256.buf)) {
+        return CRYPT_INVALID_ARG;
+    }
+
+    while (inlen > 0) {
+        if (md->sha256.curlen == 0 && inlen >= 64) {
+            size_t blocks = inlen / 64;
+            compress(md->sha256.state, in, blocks);
+            md->sha256.length += static_cast<ulong64>(blocks) * 512;
+            in += blocks * 64;
+            inlen -= blocks * 64;
+        } else {
+            unsigned long n = 64 - md->sha256.curlen;
+            if (n > inlen) n = inlen;
+            memcpy(md->sha256.buf + md->sha256.curlen, in, n);
+            md->sha256.curlen += n;
+            in += n;
+            inlen -= n;
+            if (md->sha256.curlen == 64) {
+                compress(md->sha256.state, md->sha256.buf, 1);
+                md->sha256.length += 512;
+                md->sha256.curlen = 0;
+            }
+        }
+    }
+    return CRYPT_OK;
+}
+
+int sha256_accel_done(hash_state * md, unsigned char * out) {
+    CompressBlocks compress = backend().compress;
+    if (compress == nullptr) {
+        return sha256_done(md, out);
+    }
+    if (md->sha256.curlen >= sizeof(md->sha256.buf)) {
+        return CRYPT_INVALID_ARG;
+    }
+
+    md->sha256.length += md->sha256.curlen * 8;
+    md->sha256.buf[md->sha256.curlen++] = 0x80;
+    if (md->sha256.curlen > 56) {
+        memset(md->sha256.buf + md->sha256.curlen, 0, 64 - md->sha256.curlen);
+        compress(md->sha256.state, md->sha256.buf, 1);
+        md->sha256.curlen = 0;
+    }
+    memset(md->sha256.buf + md->sha256.curlen, 0, 56 - md->sha256.curlen);
+    for (int i = 0; i < 8; i++) {
+        md->sha256.buf[56 + i] = static_cast<unsigned char>(md->sha256.length >> (56 - 8 * i));
+    }
+    compress(md->sha256.state, md->sha256.buf, 1);
+
+    for (int i = 0; i < 8; i++) {
+        store_be32(out + 4 * i, md->sha256.state[i]);
+    }
+    return CRYPT_OK;
+}
+
+/// @brief One round. Instead of shifting the working variables, the caller rotates their roles.
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, wk) do { \
+        V t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + (wk); \
+        V t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)); \
+        d += t1; \
+        h = t1 + t2; \
+    } while (0)
+
+/// @brief Eight rounds starting at round t, WK(i) gives W[i] + K256[i]. After eight rounds the roles are back in place.
+#define SHA256_ROUNDS8(WK, t) do { \
+        SHA256_ROUND(a, b, c, d, e, f, g, h, WK((t) + 0)); \
+        SHA256_ROUND(h, a, b, c, d, e, f, g, WK((t) + 1)); \
+        SHA256_ROUND(g, h, a, b, c, d, e, f, WK((t) + 2)); \
+        SHA256_ROUND(f, g, h, a, b, c, d, e, WK((t) + 3)); \
+        SHA256_ROUND(e, f, g, h, a, b, c, d, WK((t) + 4)); \
+        SHA256_ROUND(d, e, f, g, h, a, b, c, WK((t) + 5)); \
+        SHA256_ROUND(c, d, e, f, g, h, a, b, WK((t) + 6)); \
+        SHA256_ROUND(b, c, d, e, f, g, h, a, WK((t) + 7)); \
+    } while (0)
+
+#define DATA_WK(i) (W[(i) & 15] + (zero + K256[i]))
+#define PADDING_WK_AT(i) (zero + PADDING_WK[i])
+
+/// @brief SHA-256 compression of one block per lane. V is uint32_t or a vector of uint32_t.
+template <typename V>
+static inline __attribute__((always_inline)) void compress(V * state, V * W) {
+    const V zero = {};
+    V a = state[0], b = state[1], c = state[2], d = state[3];
+    V e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int t = 0; t < 64; t += 8) {
+        if (t >= 16) {
+            for (int i = t; i < t + 8; i++) {
+                V w15 = W[(i - 15) & 15];
+                V w2 = W[(i - 2) & 15];
+                V s0 = ROTR(w15, 7) ^ ROTR(w15, 18) ^ (w15 >> 3);
+                V s1 = ROTR(w2, 17) ^ ROTR(w2, 19) ^ (w2 >> 10);
+                W[i & 15] += s0 + W[(i - 7) & 15] + s1;
+            }
+        }
+        SHA256_ROUNDS8(DATA_WK, t);
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/// @brief Compression of the constant padding block, fully unrolled on the precomputed schedule.
+template <typename V>
+static inline __attribute__((always_inline)) void compress_padding(V * state) {
+    const V zero = {};
+    V a = state[0], b = state[1], c = state[2], d = state[3];
+    V e = state[4], f = state[5], g = state[6], h = state[7];
+
+    SHA256_ROUNDS8(PADDING_WK_AT, 0);
+    SHA256_ROUNDS8(PADDING_WK_AT, 8);
+    SHA256_ROUNDS8(PADDING_WK_AT, 16);
+    SHA256_ROUNDS8(PADDING_WK_AT, 24);
+    SHA256_ROUNDS8(PADDING_WK_AT, 32);
+    SHA256_ROUNDS8(PADDING_WK_AT, 40);
+    SHA256_ROUNDS8(PADDING_WK_AT, 48);
+    SHA256_ROUNDS8(PADDING_WK_AT, 56);
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/// @brief Hash LANES messages salt || input[i], one per lane of V.
+template <typename V, int LANES>
+static inline __attribute__((always_inline)) void puf_lanes(const unsigned char * salt, const unsigned char (*input)[PUF_SIZE], unsigned char (*output)[PUF_SIZE]) {
+    const V zero = {};
+    V state[8];
+    V W[16];
+
+    for (int j = 0; j < 8; j++) {
+        state[j] = zero + H256[j];
+        W[j] = zero + load_be32(salt + 4 * j);
+    }
+    // Transpose the inputs : word j of every message goes in W[8 + j]
+    for (int j = 0; j < 8; j++) {
+        uint32_t words[LANES];
+        for (int l = 0; l < LANES; l++) {
+            words[l] = load_be32(input[l] + 4 * j);
+        }
+        memcpy(&W[8 + j], words, sizeof(words));
+    }
+    compress(state, W);
+    compress_padding(state);
+
+    for (int j = 0; j < 8; j++) {
+        uint32_t words[LANES];
+        memcpy(words, &state[j], sizeof(words));
+        for (int l = 0; l < LANES; l++) {
+            store_be32(output[l] + 4 * j, words[l]);
+        }
+    }
+}
+
+/// @brief One message at a time, no buffering and no length bookkeeping
+static void puf_x1(const unsigned char * salt, const unsigned char (*input)[PUF_SIZE], unsigned char (*output)[PUF_SIZE]) {
+    puf_lanes<uint32_t, 1>(salt, input, output);
+}
+
+/// @brief 4 messages at a time : SSE2 on x86-64, NEON on ARM
+static void puf_x4(const unsigned char * salt, const unsigned char (*input)[PUF_SIZE], unsigned char (*output)[PUF_SIZE]) {
+    puf_lanes<u32x4, 4>(salt, input, output);
+}
+
+/// @brief One message with the SHA instructions
+static void puf_hw(CompressBlocks compress, const unsigned char * salt, const unsigned char * input, unsigned char * output) {
+    uint32_t state[8];
+    unsigned char block[64];
+
+    memcpy(state, H256, sizeof(state));
+    memcpy(block, salt, PUF_SIZE);
+    memcpy(block + PUF_SIZE, input, PUF_SIZE);
+    compress(state, block, 1);
+    compress(state, PADDING_BYTES, 1);
+
+    for (int j = 0; j < 8; j++) {
+        store_be32(output + 4 * j, state[j]);
+    }
+}
+
+#ifdef SHA256_X86
+/// @brief 8 messages at a time with AVX2
+__attribute__((target("avx2")))
+static void puf_x8(const unsigned char * salt, const unsigned char (*input)[PUF_SIZE], unsigned char (*output)[PUF_SIZE]) {
+    puf_lanes<u32x8, 8>(salt, input, output);
+}
+
+static bool hasAvx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+size_t sha256_lanes() {
+#ifdef SHA256_X86
+    if (hasAvx2()) return 8;
+#endif
+    if (backend().compress != nullptr) return 1;
+    return 4;
+}
+
+void sha256_puf_batch(const unsigned char * salt, const unsigned char (*input)[PUF_SIZE], size_t n, unsigned char (*output)[PUF_SIZE]) {
+    size_t i = 0;
+
+#ifdef SHA256_X86
+    if (hasAvx2()) {
+        for (; i + 8 <= n; i += 8) {
+            puf_x8(salt, input + i, output + i);
+        }
+    }
+#endif
+    // Eight AVX2 lanes keep up with SHA-NI, the SHA instructions win over four SSE2 or NEON lanes
+    CompressBlocks compress = backend().compress;
+    if (compress != nullptr) {
+        for (; i < n; i++) {
+            puf_hw(compress, salt, input[i], output[i]);
+        }
+        return;
+    }
+
+    for (; i + 4 <= n; i += 4) {
+        puf_x4(salt, input + i, output + i);
+    }
+    for (; i < n; i++) {
+        puf_x1(salt, input + i, output + i);
+    }
+}
+
+void sha256_puf(const unsigned char * salt, const unsigned char * input, unsigned char * output) {
+    CompressBlocks compress = backend().compress;
+    if (compress != nullptr) {
+        puf_hw(compress, salt, input, output);
+    } else {
+        puf_x1(salt, reinterpret_cast<const unsigned char (*)[PUF_SIZE]>(input), reinterpret_cast<unsigned char (*)[PUF_SIZE]>(output));
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * @file sha256.hpp
+ * @brief SHA-256 backends header
+ *
+ * This file holds the SHA-256 backends. The block compression runs on the SHA instructions of the CPU
+ * when it has them (SHA-NI on x86, SHA2 crypto extension on ARMv8) and on LibTomCrypt otherwise ;
+ * the choice is made once, at the first use or in warmup().
+ *
+ * A PUF evaluation always hashes salt || input, two 32 bytes values, so every message has the same
+ * shape : one data block followed by one constant padding block. Several messages are hashed in
+ * parallel, one per SIMD lane (8 lanes with AVX2, 4 lanes with SSE2 or NEON).
+ *
+ */
+
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <cstddef>
+
+#include "utils.hpp"
+
+/**
+ * @brief Select the hashing backend for this CPU. Called by warmup(), otherwise done at the first hash.
+ *
+ * @return The backend name
+ */
+const char * sha256_select_backend();
+
+/**
+ * @brief LibTomCrypt compatible SHA-256 on the selected backend. The hash_state is the LibTomCrypt one.
+ *
+ * @param md
+ * @return CRYPT_OK
+ */
+int sha256_accel_init(hash_state * md);
+int sha256_accel_process(hash_state * md, const unsigned char * in, unsigned long inlen);
+int sha256_accel_done(hash_state * md, unsigned char * out);
+
+/**
+ * @brief Index of the SHA-256 descriptor running on the selected backend, registered in LibTomCrypt.
+ * To be used instead of find_hash("sha256"), so HMAC and HKDF benefit from the acceleration too.
+ *
+ * @return int
+ */
+int sha256_hash_index();
+
+/**
+ * @brief Compute SHA256(salt || input) for one input of PUF_SIZE bytes, on a path specialised for that
+ * fixed 64 bytes message : no buffering, precomputed padding block schedule, unrolled rounds.
+ *
+ * @param salt PUF_SIZE bytes
+ * @param input PUF_SIZE bytes
+ * @param output
+ */
+void sha256_puf(const unsigned char * salt, const unsigned char * input, unsigned char * output);
+
+/**
+ * @brief Compute SHA256(salt || input) for n inputs of PUF_SIZE bytes.
+ * Uses 8 AVX2 lanes when available, then the SHA instructions, then 4 SSE2 or NEON lanes.
+ *
+ * @param salt PUF_SIZE bytes
+ * @param input n inputs
+ * @param n
+ * @param output n digests
+ */
+void sha256_puf_batch(const unsigned char * salt, const unsigned char (*input)[PUF_SIZE], size_t n, unsigned char (*output)[PUF_SIZE]);
+
+/**
+ * @brief Number of messages hashed at once by the kernel selected on this CPU.
+ *
+ * @return size_t
+ */
+size_t sha256_lanes();
+
+#endif
@@ -8,29 +8,18 @@
 
 
 #include "utils.hpp"
+#include "sha256.hpp"
+#include "drbg.hpp"
 
 /**
  * @brief Generates a random 256 bits unsigned char.
+ * The bytes come from the ChaCha20 generator of the calling thread, see drbg.hpp.
  * 
  * @param buffer 
  * @param size 
  */
 void generate_random_bytes(unsigned char* buffer, size_t size) {
-    std::random_device rd;
-    std::mt19937_64 gen(rd()); // 64-bit generator
-
-    size_t i = 0;
-    while (i + 8 <= size) {  // Process in 8-byte chunks
-        uint64_t rand_val = gen();
-        std::memcpy(buffer + i, &rand_val, 8);
-        i += 8;
-    }
-
-    // Handle remaining bytes (if size is not a multiple of 8)
-    if (i < size) {
-        uint64_t rand_val = gen();
-        std::memcpy(buffer + i, &rand_val, size - i);
-    }
+    drbg_generate(buffer, size);
 }
 
 /**
@@ -83,53 +72,12 @@ void xor_buffers(const unsigned char* input1, const unsigned char* input2, size_
     }
 }
 
-/**
- * @brief Initiate a hashing context
- * 
- * @return * Function* 
- */hash_state* initHash(){
-    hash_state* ctx = new hash_state();
-    sha256_init(ctx);
-    return ctx;
-}
-
-/**
- * @brief Specialization of the variadic template for buffers containing 32 Bytes numbers
- * 
- * @param ctx 
- * @param data 
- * @param size 
- */
-void addToHash(hash_state* ctx, const unsigned char* data, size_t size){
-    sha256_process(ctx, data, size);
-}
-
-/**
- * @brief Specialization of the variadic template for std::string type
- * 
- * @param ctx 
- * @param str 
- */void addToHash(hash_state* ctx, const std::string& str){
-    sha256_process(ctx, reinterpret_cast<const unsigned char*>(str.data()), str.size());
-}
-
-/**
- * @brief Calculate the hash value with every elements added to the context
- * 
- * @param ctx 
- * @param output 
- */
-void calculateHash(hash_state* ctx, unsigned char * output){
-    sha256_done(ctx, output);
-    delete ctx;
-}
-
 /**
  * @brief Print the content of a MsgPack data.
  * 
  * @param msg 
  */
-void printMsg(std::unordered_map<std::string, std::string> data){
+void printMsg(const std::unordered_map<std::string, std::string> &data){
     if(data.empty()){
         std::cerr << "Error: MsgPack data is empty!" << std::endl;
         return;
@@ -222,12 +170,8 @@ void deriveKeyUsingHKDF(const unsigned char* NA, const unsigned char* NB, const
     unsigned char ctr = 1;
     unsigned long hash_len_l = hash_len;
     // Extract step: PRK = HMAC-Hash(salt, IKM)
-    static bool hash_registered = false;
-    if (!hash_registered) {
-        register_hash(&sha256_desc);
-        hash_registered = true;
-    }
-    err = hmac_memory(find_hash("sha256"), S, 32, input_key_material, sizeof(input_key_material), prk, &hash_len_l);
+    int hash_idx = sha256_hash_index();
+    err = hmac_memory(hash_idx, S, 32, input_key_material, sizeof(input_key_material), prk, &hash_len_l);
     if (err != CRYPT_OK) {
         // handle error
         std::cout << "err = " << err << std::endl;
@@ -239,7 +183,7 @@ void deriveKeyUsingHKDF(const unsigned char* NA, const unsigned char* NB, const
     unsigned char prev[32];
     hmac_state hmac;
     for (unsigned int i = 0; i < n; ++i) {
-        hmac_init(&hmac, find_hash("sha256"), prk, hash_len);
+        hmac_init(&hmac, hash_idx, prk, hash_len);
 
         if (i > 0) {
             hmac_process(&hmac, prev, hash_len);
@@ -257,7 +201,7 @@ void deriveKeyUsingHKDF(const unsigned char* NA, const unsigned char* NB, const
     }
 }
 
-bool extractValueFromMap(std::unordered_map<std::string, std::string> map, std::string key , unsigned char * output, size_t size){
+bool extractValueFromMap(const std::unordered_map<std::string, std::string> &map, const std::string &key, unsigned char * output, size_t size){
 
     auto it = map.find(key);
     if (it == map.end()) {
@@ -277,4 +221,7 @@ bool extractValueFromMap(std::unordered_map<std::string, std::string> map, std::
 
 void warmup(){
     register_hash(&sha256_desc);
+    sha256_select_backend();
+    drbg_fill();
+    PROD_ONLY({std::cout << "SHA-256 backend : " << sha256_select_backend() << std::endl;});
 }
\ No newline at end of file
@@ -73,56 +73,12 @@ void print_hex(const unsigned char *buffer, size_t length);
  */
 void xor_buffers(const unsigned char* input1, const unsigned char* input2, size_t size, unsigned char* output);
 
-/**
- * @brief Initiate a hashing context
- * 
- * @return * Function* 
- */
-hash_state* initHash();
-
-/**
- * @brief Basinc variadic template that allow to add different types of data to a hash.
- * 
- * @param ctx 
- * @param value 
- * @return * Basic 
- */
-template <typename T>
-inline void addToHash(hash_state* ctx, const T& value){
-    sha256_process(ctx, reinterpret_cast<const unsigned char*>(&value), sizeof(T));
-}
-
-/**
- * @brief Specialization of the variadic template for buffers containing 32 Bytes numbers
- * 
- * @param ctx 
- * @param data 
- * @param size 
- */
-void addToHash(hash_state* ctx, const unsigned char* data, size_t size);
-
-/**
- * @brief Specialization of the variadic template for std::string type
- * 
- * @param ctx 
- * @param str 
- */
-void addToHash(hash_state* ctx, const std::string& str);
-
-/**
- * @brief Calculate the hash value with every elements added to the context
- * 
- * @param ctx 
- * @param output 
- */
-void calculateHash(hash_state* ctx, unsigned char * output);
-
 /**
  * @brief Print the content of a MsgPack value.
  * 
  * @param msg 
  */
-void printMsg(std::unordered_map<std::string, std::string> data);
+void printMsg(const std::unordered_map<std::string, std::string> &data);
 
 /**
  * @brief Try to get the current CPU Frequency. Might be skewed, only to be used as a support option.
@@ -154,7 +110,7 @@ void deriveKeyUsingHKDF(const unsigned char* NA, const unsigned char* NB, const
  * @return true 
  * @return false 
  */
-bool extractValueFromMap(std::unordered_map<std::string, std::string> map, std::string key , unsigned char * output, size_t size);
+bool extractValueFromMap(const std::unordered_map<std::string, std::string> &map, const std::string &key, unsigned char * output, size_t size);
 
 /**
  * @brief Warmup for LibTomCrypt